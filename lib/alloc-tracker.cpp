@@ -0,0 +1,140 @@
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+#include "alloc-tracker.h"
+
+static std::atomic<size_t> allocations{0};
+static std::atomic<size_t> deallocations{0};
+static std::atomic<size_t> bytes_allocated{0};
+static std::atomic<size_t> current_bytes{0};
+static std::atomic<size_t> peak_bytes{0};
+
+#ifdef TRACK_ALLOCATIONS
+
+// NOTE: every block gets a header holding its size so delete knows how much
+// to take off current_bytes, the header keeps the max_align_t alignment
+static constexpr size_t header_size = alignof(std::max_align_t);
+
+static void* tracked_alloc(size_t size) {
+    void* block = std::malloc(size + header_size);
+    if (block == nullptr) {
+        return nullptr;
+    }
+    *static_cast<size_t*>(block) = size;
+
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes_allocated.fetch_add(size, std::memory_order_relaxed);
+    size_t current = current_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = peak_bytes.load(std::memory_order_relaxed);
+    while (current > peak && !peak_bytes.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {}
+
+    return static_cast<char*>(block) + header_size;
+}
+
+static void tracked_free(void* ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    void* block = static_cast<char*>(ptr) - header_size;
+
+    deallocations.fetch_add(1, std::memory_order_relaxed);
+    current_bytes.fetch_sub(*static_cast<size_t*>(block), std::memory_order_relaxed);
+
+    std::free(block);
+}
+
+void* operator new(size_t size) {
+    void* ptr = tracked_alloc(size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return tracked_alloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return tracked_alloc(size);
+}
+
+void operator delete(void* ptr) noexcept { tracked_free(ptr); }
+void operator delete[](void* ptr) noexcept { tracked_free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { tracked_free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { tracked_free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { tracked_free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { tracked_free(ptr); }
+
+bool allocation_tracking_enabled() {
+    return true;
+}
+
+#else
+
+bool allocation_tracking_enabled() {
+    return false;
+}
+
+#endif
+
+/**
+ *  @brief Snapshot of the global allocation counters.
+ *  @returns The counters since program start.
+**/
+AllocationStats get_allocation_stats() {
+    AllocationStats stats;
+    stats.allocations = allocations.load(std::memory_order_relaxed);
+    stats.deallocations = deallocations.load(std::memory_order_relaxed);
+    stats.bytes_allocated = bytes_allocated.load(std::memory_order_relaxed);
+    stats.current_bytes = current_bytes.load(std::memory_order_relaxed);
+    stats.peak_bytes = peak_bytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+/**
+ *  @brief Lowers the peak to the current heap size so the next peak is per run.
+**/
+void reset_allocation_peak() {
+    peak_bytes.store(current_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+/**
+ *  @brief Prints the allocations made between two snapshots.
+ *  @param os stream to print to.
+ *  @param before snapshot taken before the run, after reset_allocation_peak().
+ *  @param after snapshot taken after the run.
+ *  @param tokens amount of Tokens produced by the run.
+ *  @param input_bytes size of the tokenized input.
+**/
+void print_allocation_report(
+    std::ostream& os,
+    const AllocationStats& before,
+    const AllocationStats& after,
+    size_t tokens,
+    size_t input_bytes
+) {
+    if (!allocation_tracking_enabled()) {
+        os << "allocation tracking not compiled in, build with -DTRACK_ALLOCATIONS" << std::endl;
+        return;
+    }
+
+    size_t count = after.allocations - before.allocations;
+    size_t bytes = after.bytes_allocated - before.bytes_allocated;
+    size_t peak = after.peak_bytes - before.current_bytes;
+
+    os << std::fixed << std::setprecision(2)
+       << "allocations:       " << count
+       << " (" << (tokens > 0 ? (double)count / tokens : 0.0) << " per token)" << std::endl
+       << "bytes allocated:   " << bytes
+       << " (" << (input_bytes > 0 ? (double)bytes / input_bytes : 0.0) << " per input byte)" << std::endl
+       << "peak heap:         " << peak
+       << " (" << (input_bytes > 0 ? (double)peak / input_bytes : 0.0) << "x input)" << std::endl;
+}
@@ -0,0 +1,31 @@
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+// NOTE: the global operator new/delete hooks are only compiled in when
+// alloc-tracker.cpp is built with -DTRACK_ALLOCATIONS, see the *-alloc
+// targets in the makefile. Otherwise every counter stays at 0.
+
+#include <cstddef>
+#include <ostream>
+
+struct AllocationStats {
+    size_t allocations = 0;
+    size_t deallocations = 0;
+    size_t bytes_allocated = 0;
+    size_t current_bytes = 0;
+    size_t peak_bytes = 0;
+};
+
+bool allocation_tracking_enabled();
+AllocationStats get_allocation_stats();
+void reset_allocation_peak();
+
+void print_allocation_report(
+    std::ostream& os,
+    const AllocationStats& before,
+    const AllocationStats& after,
+    size_t tokens,
+    size_t input_bytes
+);
+
+#endif
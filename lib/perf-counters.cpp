@@ -0,0 +1,188 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <array>
+#include <cstring>
+#include <cstdint>
+#include "perf-counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ *  @brief Name of a PerfEvent like perf stat prints it, e.g. "branch-misses".
+**/
+const std::string& perf_event_name(PerfEvent event) {
+    static const std::string names[PERF_EVENT_COUNT] = {
+        "cycles", "instructions", "branch-misses", "L1-dcache-misses", "LLC-misses"
+    };
+    return names[(int)event];
+}
+
+#ifdef __linux__
+
+/**
+ *  @brief Opens one disabled, user space only counter for the calling thread.
+ *  @returns The file descriptor, or -1.
+**/
+static int open_counter(PerfEvent event) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;  // NOTE: allowed with perf_event_paranoid <= 2
+    attr.exclude_hv = 1;
+    // NOTE: the kernel multiplexes counters when there are too few, the
+    // enabled/running times are used to scale those back up
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (event) {
+        case PerfEvent::CYCLES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PerfEvent::INSTRUCTIONS:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PerfEvent::BRANCH_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case PerfEvent::L1D_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config =
+                PERF_COUNT_HW_CACHE_L1D |
+                (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case PerfEvent::LLC_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+    }
+
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+#endif
+
+/**
+ *  @brief PerfCounters constructor, opens every counter it can.
+**/
+PerfCounters::PerfCounters() {
+    for (int i=0; i < PERF_EVENT_COUNT; i++) {
+#ifdef __linux__
+        this->fds[i] = open_counter((PerfEvent)i);
+#else
+        this->fds[i] = -1;
+#endif
+    }
+}
+
+/**
+ *  @brief PerfCounters destructor, closes the counters.
+**/
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (int fd : this->fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+/**
+ *  @brief Whether at least one counter opened.
+**/
+bool PerfCounters::available() const {
+    for (int fd : this->fds) {
+        if (fd >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ *  @brief Resets and starts every counter.
+**/
+void PerfCounters::start() {
+#ifdef __linux__
+    for (int fd : this->fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+/**
+ *  @brief Stops every counter.
+ *  @returns The counts since start(), scaled up if a counter was multiplexed.
+**/
+PerfCounts PerfCounters::stop() {
+    PerfCounts counts;
+
+#ifdef __linux__
+    for (int fd : this->fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    for (int i=0; i < PERF_EVENT_COUNT; i++) {
+        // NOTE: value, time enabled, time running
+        uint64_t data[3];
+        if (this->fds[i] < 0 || read(this->fds[i], data, sizeof(data)) != sizeof(data) || data[2] == 0) {
+            continue;
+        }
+        counts.values[i] = data[2] < data[1] ? (uint64_t)((double)data[0] * data[1] / data[2]) : data[0];
+        counts.valid[i] = true;
+    }
+#endif
+
+    return counts;
+}
+
+/**
+ *  @brief Prints every valid counter per input byte and per Token, on one line.
+ *  @param name what was measured, e.g. "tokenize".
+**/
+void print_perf_report(
+    std::ostream& os,
+    const std::string& name,
+    const PerfCounts& counts,
+    size_t tokens,
+    size_t input_bytes
+) {
+    os << "  " << name << ":";
+
+    bool any = false;
+    for (int i=0; i < PERF_EVENT_COUNT; i++) {
+        if (!counts.valid[i]) {
+            continue;
+        }
+        any = true;
+        os << std::fixed << std::setprecision(2)
+           << " " << perf_event_name((PerfEvent)i) << " "
+           << (input_bytes > 0 ? (double)counts.values[i] / input_bytes : 0.0) << "/byte "
+           << (tokens > 0 ? (double)counts.values[i] / tokens : 0.0) << "/token";
+    }
+
+    int cycles = (int)PerfEvent::CYCLES;
+    int instructions = (int)PerfEvent::INSTRUCTIONS;
+    if (counts.valid[cycles] && counts.valid[instructions] && counts.values[cycles] > 0) {
+        os << " IPC " << (double)counts.values[instructions] / counts.values[cycles];
+    }
+    if (!any) {
+        os << " no counters";
+    }
+    os << std::endl;
+}
@@ -0,0 +1,66 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+// NOTE: Linux only, elsewhere (or without permission, see
+// /proc/sys/kernel/perf_event_paranoid, or without a PMU as in most VMs)
+// no counter opens and available() is false, callers fall back to timing only
+
+#include <array>
+#include <string>
+#include <ostream>
+#include <cstddef>
+#include <cstdint>
+
+enum class PerfEvent {
+    CYCLES,
+    INSTRUCTIONS,
+    BRANCH_MISSES,
+    L1D_MISSES,     // NOTE: L1 data cache read misses
+    LLC_MISSES      // NOTE: last level cache misses
+};
+
+const int PERF_EVENT_COUNT = (int)PerfEvent::LLC_MISSES + 1;
+
+const std::string& perf_event_name(PerfEvent event);
+
+struct PerfCounts {
+    std::array<uint64_t, PERF_EVENT_COUNT> values{};
+    std::array<bool, PERF_EVENT_COUNT> valid{};  // NOTE: false if the counter didn't open
+};
+
+/**
+ *  @brief Hardware counters of the calling thread (user space only) around a
+ *  piece of code, through perf_event_open. Counters that can't be opened are
+ *  skipped, the others still count.
+ *
+ *      PerfCounters counters;
+ *      counters.start();
+ *      ...
+ *      PerfCounts counts = counters.stop();
+**/
+class PerfCounters {
+    private:
+        std::array<int, PERF_EVENT_COUNT> fds;
+
+    public:
+        PerfCounters();
+        ~PerfCounters();
+
+        // not copyable, owns the counter file descriptors
+        PerfCounters(const PerfCounters&) = delete;
+        void operator=(const PerfCounters&) = delete;
+
+        bool available() const;
+        void start();
+        PerfCounts stop();
+};
+
+void print_perf_report(
+    std::ostream& os,
+    const std::string& name,
+    const PerfCounts& counts,
+    size_t tokens,
+    size_t input_bytes
+);
+
+#endif
@@ -0,0 +1,172 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include "trace.h"
+
+// NOTE: plain bool, only written by trace_enable() before the threads it
+// traces are started
+bool trace_on = false;
+
+struct TraceEvent {
+    const char* name;
+    std::string arg;
+    int64_t start_ns;
+    int64_t end_ns;
+};
+
+struct TraceBuffer {
+    int tid;
+    std::string thread_name;
+    std::vector<TraceEvent> events;
+};
+
+// NOTE: buffers outlive their threads, trace_write runs after they exit
+static std::mutex buffers_mutex;
+static std::vector<std::unique_ptr<TraceBuffer>> buffers;
+static const std::chrono::steady_clock::time_point trace_start = std::chrono::steady_clock::now();
+
+/**
+ *  @brief The calling thread's buffer, registered on first use.
+**/
+static TraceBuffer& thread_buffer() {
+    thread_local TraceBuffer* buffer = nullptr;
+
+    if (buffer == nullptr) {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        buffers.push_back(std::make_unique<TraceBuffer>());
+        buffer = buffers.back().get();
+        buffer->tid = buffers.size();
+        buffer->thread_name = "thread " + std::to_string(buffer->tid);
+    }
+
+    return *buffer;
+}
+
+/**
+ *  @brief Starts recording TraceSpans.
+**/
+void trace_enable() {
+    trace_on = true;
+}
+
+/**
+ *  @brief Names the calling thread in the trace, e.g. "tokenizer".
+**/
+void trace_set_thread_name(const std::string& name) {
+    if (trace_on) {
+        thread_buffer().thread_name = name;
+    }
+}
+
+/**
+ *  @brief Nanoseconds since the program started.
+**/
+int64_t trace_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - trace_start
+    ).count();
+}
+
+/**
+ *  @brief Adds an event to the calling thread's buffer, see TraceSpan.
+**/
+void trace_record(const char* name, std::string_view arg, int64_t start_ns, int64_t end_ns) {
+    thread_buffer().events.push_back({name, std::string(arg), start_ns, end_ns});
+}
+
+/**
+ *  @brief Adds a track named name, shown like a thread.
+ *  @returns The track for trace_record_on.
+**/
+int trace_add_track(const std::string& name) {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    buffers.push_back(std::make_unique<TraceBuffer>());
+    buffers.back()->tid = buffers.size();
+    buffers.back()->thread_name = name;
+    return buffers.size() - 1;
+}
+
+/**
+ *  @brief Adds an event to a track from trace_add_track. A track must only
+ *  be recorded on by one thread.
+**/
+void trace_record_on(int track, const char* name, std::string_view arg, int64_t start_ns, int64_t end_ns) {
+    TraceBuffer* buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        buffer = buffers[track].get();
+    }
+    buffer->events.push_back({name, std::string(arg), start_ns, end_ns});
+}
+
+/**
+ *  @brief Writes s as the contents of a JSON string.
+**/
+static void write_json_string(std::ostream& os, std::string_view s) {
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        }
+        else if ((unsigned char)c < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            os << escaped;
+        }
+        else {
+            os << c;
+        }
+    }
+}
+
+/**
+ *  @brief Writes every recorded event in the Chrome trace event format.
+ *  Must only be called once every traced thread is done.
+ *  @param fname file to write.
+ *  @returns false if the file couldn't be written.
+**/
+bool trace_write(const std::string& fname) {
+    std::ofstream file(fname);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    bool first = true;
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    for (const std::unique_ptr<TraceBuffer>& buffer : buffers) {
+        file << (first ? "" : ",\n")
+             << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->tid
+             << ", \"args\": {\"name\": \"";
+        write_json_string(file, buffer->thread_name);
+        file << "\"}}";
+        first = false;
+
+        for (const TraceEvent& event : buffer->events) {
+            // NOTE: "X" is a complete event, ts and dur are in microseconds
+            file << ",\n{\"name\": \"";
+            write_json_string(file, event.name);
+            file << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->tid
+                 << ", \"ts\": " << event.start_ns / 1000.0
+                 << ", \"dur\": " << (event.end_ns - event.start_ns) / 1000.0;
+            if (!event.arg.empty()) {
+                file << ", \"args\": {\"file\": \"";
+                write_json_string(file, event.arg);
+                file << "\"}";
+            }
+            file << "}";
+        }
+    }
+    file << "\n]}\n";
+
+    return file.good();
+}
@@ -0,0 +1,60 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// NOTE: scoped spans written as Chrome trace events, open the file in
+// https://ui.perfetto.dev or chrome://tracing
+//
+//     trace_enable();                        // before any thread starts
+//     {
+//         TraceSpan span("tokenize", fname); // one event from here to the end of the scope
+//         ...
+//     }
+//     trace_write("out.json");              // after every thread is done
+//
+// Every thread records into its own buffer, no locking per span. Until
+// trace_enable() is called a TraceSpan is a single untaken branch.
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+extern bool trace_on;
+
+void trace_enable();
+void trace_set_thread_name(const std::string& name);
+bool trace_write(const std::string& fname);
+
+void trace_record(const char* name, std::string_view arg, int64_t start_ns, int64_t end_ns);
+int64_t trace_now_ns();
+
+// NOTE: a track is a timeline of its own, for spans of one thread that
+// overlap instead of nest (e.g. reads in flight on one io_uring)
+int trace_add_track(const std::string& name);
+void trace_record_on(int track, const char* name, std::string_view arg, int64_t start_ns, int64_t end_ns);
+
+/**
+ *  @brief Records one complete event named name, lasting as long as the span.
+ *  name has to be a string literal (or outlive trace_write), arg is copied.
+**/
+class TraceSpan {
+    private:
+        const char* name;
+        std::string_view arg;
+        int64_t start_ns;
+
+    public:
+        explicit TraceSpan(const char* name, std::string_view arg = std::string_view())
+            : name(name), arg(arg), start_ns(trace_on ? trace_now_ns() : -1) {}
+
+        ~TraceSpan() {
+            if (this->start_ns >= 0) {
+                trace_record(this->name, this->arg, this->start_ns, trace_now_ns());
+            }
+        }
+
+        // not copyable, one span is one event
+        TraceSpan(const TraceSpan&) = delete;
+        void operator=(const TraceSpan&) = delete;
+};
+
+#endif
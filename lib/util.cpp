@@ -58,6 +58,23 @@ std::vector<std::string> read_lines(std::string fname) {
     return results;
 }
 
+// NOTE: same lines as read_lines would give for a file holding contents
+std::vector<std::string> split_lines(const std::string& contents) {
+    std::vector<std::string> results;
+
+    size_t line_start = 0;
+    while (line_start < contents.size()) {
+        size_t line_end = contents.find('\n', line_start);
+        if (line_end == std::string::npos) {
+            line_end = contents.size();
+        }
+        results.emplace_back(contents, line_start, line_end - line_start);
+        line_start = line_end + 1;
+    }
+
+    return results;
+}
+
 bool file_exists(std::string fname) {
     struct stat buffer;
     return (stat (fname.c_str(), &buffer) == 0);
@@ -15,6 +15,7 @@ std::string ltrim(std::string s);
 
 std::string read_file(std::string fname);
 std::vector<std::string> read_lines(std::string fname);
+std::vector<std::string> split_lines(const std::string& contents);
 bool file_exists(std::string fname);
 
 #endif
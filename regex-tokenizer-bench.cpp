@@ -0,0 +1,1136 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <regex>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <cstdio>
+#include "unicode.h"
+#include "string-scanner.h"
+#include "keywords.h"
+#include "util.h"
+#include "regex-tokenizer.h"
+#include "alloc-tracker.h"
+#include "perf-counters.h"
+#include "trace.h"
+#include "file-loader.h"
+#include "batch-tokenizer.h"
+#include "token-pipeline.h"
+#include "token-diff.h"
+#include "token-index.h"
+
+// NOTE: make regex-tokenizer-bench, then ./regex-tokenizer-bench [mode]
+// every mode prints one line per measured input
+
+static volatile size_t bench_sink = 0;
+
+/**
+ *  @brief Runs f runs times and keeps the fastest run.
+ *  @returns The fastest run in seconds.
+**/
+template <class F>
+double best_of(int runs, F f) {
+    double best = 0;
+
+    for (int i=0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (i == 0 || elapsed.count() < best) {
+            best = elapsed.count();
+        }
+    }
+
+    return best;
+}
+
+void print_result(const std::string& name, size_t bytes, double seconds) {
+    size_t blocks = bytes / ASCII_BLOCK_SIZE;
+
+    std::cout
+        << std::left << std::setw(28) << name
+        << std::right << std::setw(10) << std::fixed << std::setprecision(1)
+        << bytes / seconds / (1024 * 1024) << " MB/s"
+        << std::setw(10) << std::setprecision(2)
+        << seconds * 1e9 / blocks << " ns/block"
+        << std::endl;
+}
+
+/**
+ *  @brief Builds a buffer of space separated identifiers.
+ *  @param size approximate size of the buffer in bytes.
+ *  @param mixed_every every mixed_every'th identifier gets a non-ASCII character, 0 for none.
+**/
+std::string build_identifiers(size_t size, int mixed_every) {
+    const std::string ascii_chars = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
+    const std::vector<std::string> non_ascii = {"é", "ß", "λ", "名前", "ñ", "Ω"};
+    std::mt19937 rng(1234);
+    std::string out;
+    int count = 0;
+
+    while (out.size() < size) {
+        int length = 3 + rng() % 18;
+        out += ascii_chars[rng() % 53];  // NOTE: no leading digits
+        for (int i=1; i < length; i++) {
+            out += ascii_chars[rng() % ascii_chars.size()];
+        }
+        if (mixed_every > 0 && ++count % mixed_every == 0) {
+            out += non_ascii[rng() % non_ascii.size()];
+        }
+        out += ' ';
+    }
+
+    return out;
+}
+
+void bench_identifiers_input(const std::string& name, const std::string& input) {
+    double classify = best_of(10, [&]() {
+        size_t ascii_blocks = 0;
+        for (size_t i=0; i + ASCII_BLOCK_SIZE <= input.size(); i += ASCII_BLOCK_SIZE) {
+            ascii_blocks += is_ascii_block(input.data() + i);
+        }
+        bench_sink += ascii_blocks;
+    });
+    print_result(name + " classify", input.size(), classify);
+
+    double scan = best_of(10, [&]() {
+        size_t pos = 0, names = 0;
+        while (pos < input.size()) {
+            size_t length = scan_identifier(input, pos);
+            names += length > 0;
+            pos += length + 1;
+        }
+        bench_sink += names;
+    });
+    print_result(name + " scan_identifier", input.size(), scan);
+}
+
+/**
+ *  @brief ASCII only vs mixed identifier scanning, per ASCII_BLOCK_SIZE block.
+**/
+int bench_identifiers() {
+    const size_t size = 4 * 1024 * 1024;
+
+    std::cout << "block size: " << ASCII_BLOCK_SIZE << " bytes" << std::endl;
+    bench_identifiers_input("ascii", build_identifiers(size, 0));
+    bench_identifiers_input("mixed 1/16", build_identifiers(size, 16));
+    bench_identifiers_input("mixed 1/2", build_identifiers(size, 2));
+
+    // NOTE: keyword classification of NAMEs, one in four is a keyword
+    std::vector<std::string> words;
+    std::istringstream identifiers(build_identifiers(size / 16, 0));
+    for (std::string word; identifiers >> word;) {
+        words.push_back(word);
+        if (words.size() % 3 == 0) {
+            words.push_back(std::string(keyword_names[1 + words.size() % (KEYWORD_COUNT - 1)]));
+        }
+    }
+    double perfect_hash = best_of(10, [&]() {
+        size_t keywords = 0;
+        for (const std::string& word : words) {
+            keywords += classify_keyword(word) != Keyword::NOT_A_KEYWORD;
+        }
+        bench_sink += keywords;
+    });
+    double compares = best_of(10, [&]() {
+        size_t keywords = 0;
+        for (const std::string& word : words) {
+            keywords += std::find(keyword_names.begin() + 1, keyword_names.end(), word) != keyword_names.end();
+        }
+        bench_sink += keywords;
+    });
+    std::cout
+        << std::fixed << std::setprecision(2)
+        << "keywords: perfect hash " << perfect_hash * 1e9 / words.size() << " ns/word, "
+        << "string compares " << compares * 1e9 / words.size() << " ns/word"
+        << std::endl;
+
+    return 0;
+}
+
+/**
+ *  @brief Builds a data line like: data = ["ab", 'c\'d', b"ef", ...]
+ *  @param strings amount of string literals on the line.
+**/
+std::string build_string_line(int strings) {
+    const std::vector<std::string> literals = {
+        "\"ab\"", "'cd'", "\"e\\\"f\"", "'g\\'h'", "b\"ij\"", "rb'kl'", "f\"{mn}\"", "u'op'"
+    };
+    std::string line = "data = [";
+
+    for (int i=0; i < strings; i++) {
+        if (i > 0) {
+            line += ", ";
+        }
+        line += literals[i % literals.size()];
+    }
+
+    return line + "]";
+}
+
+/**
+ *  @brief scan_string vs the old greedy STRING regex at every string start
+ *  of data heavy lines, then the whole Tokenizer on those lines.
+**/
+int bench_strings() {
+    const std::regex old_string_regex("^(r?b?\".*\")");
+
+    for (int strings : {10, 100, 1000}) {
+        std::string line = build_string_line(strings);
+        std::vector<size_t> starts;
+        for (size_t pos=0; pos < line.size(); pos++) {
+            StringMatch match = scan_string(line, pos);
+            if (match.type == StringScan::STRING) {
+                starts.push_back(pos);
+                pos += match.length - 1;
+            }
+        }
+
+        double scanner = best_of(10, [&]() {
+            size_t total = 0;
+            for (size_t pos : starts) {
+                total += scan_string(line, pos).length;
+            }
+            bench_sink += total;
+        });
+        double regex = best_of(3, [&]() {
+            size_t total = 0;
+            std::smatch match;
+            for (size_t pos : starts) {
+                if (std::regex_search(line.cbegin() + pos, line.cend(), match, old_string_regex)) {
+                    total += match.length(0);
+                }
+            }
+            bench_sink += total;
+        });
+
+        std::vector<std::string> contents(1000 / strings + 1, line);
+        size_t input_bytes = contents.size() * (line.size() + 1);
+        double tokenize = best_of(3, [&]() {
+            bench_sink += BasicTokenizer<CountingSink>(contents).get_sink().total;
+        });
+
+        std::cout
+            << std::setw(5) << strings << " strings/line (" << line.size() << " bytes): "
+            << std::fixed << std::setprecision(1)
+            << "scan_string " << scanner * 1e9 / starts.size() << " ns/string, "
+            << "old regex " << regex * 1e9 / starts.size() << " ns/string, "
+            << "tokenize " << input_bytes / tokenize / (1024 * 1024) << " MB/s"
+            << std::endl;
+    }
+
+    return 0;
+}
+
+/**
+ *  @brief Runs f once between counters.start() and counters.stop().
+**/
+template <class F>
+PerfCounts count_events(PerfCounters& counters, F f) {
+    counters.start();
+    f();
+    return counters.stop();
+}
+
+/**
+ *  @brief Times the Tokenizer over each file, with hardware counters when
+ *  perf_event_open is allowed and allocation counts in the allocation
+ *  tracking build (make regex-tokenizer-bench-alloc).
+**/
+int bench_tokenize(const std::vector<std::string>& fnames) {
+    PerfCounters counters;
+    if (!counters.available()) {
+        std::cout << "perf counters unavailable, timing only" << std::endl;
+    }
+
+    for (const std::string& fname : fnames) {
+        if (!file_exists(fname)) {
+            std::cout << "No file named \"" << fname << "\"" << std::endl;
+            return 1;
+        }
+        std::vector<std::string> contents = read_lines(fname);
+        size_t input_bytes = 0;
+        for (const std::string& line : contents) {
+            input_bytes += line.size() + 1;
+        }
+
+        // NOTE: one untimed run to count Tokens and allocations
+        reset_allocation_peak();
+        AllocationStats before = get_allocation_stats();
+        int tokens = Tokenizer(contents).size();
+        AllocationStats after = get_allocation_stats();
+        reset_allocation_peak();
+        AllocationStats counting_before = get_allocation_stats();
+        bench_sink += BasicTokenizer<CountingSink>(contents).get_sink().total;
+        AllocationStats counting_after = get_allocation_stats();
+
+        double seconds = best_of(5, [&]() {
+            bench_sink += Tokenizer(contents).size();
+        });
+        double counting_seconds = best_of(5, [&]() {
+            bench_sink += BasicTokenizer<CountingSink>(contents).get_sink().total;
+        });
+        double structure_seconds = best_of(5, [&]() {
+            StructureIndex structure;
+            TokenizerOptions options;
+            options.structure = &structure;
+            bench_sink += Tokenizer(contents, options).size();
+        });
+        LineCacheStats cache_stats;
+        double cached_seconds = best_of(5, [&]() {
+            LineCache line_cache;
+            TokenizerOptions options;
+            options.line_cache = &line_cache;
+            bench_sink += Tokenizer(contents, options).size();
+            cache_stats = line_cache.stats();
+        });
+
+        std::cout
+            << fname << ": " << input_bytes << " bytes, " << tokens << " tokens, "
+            << std::fixed << std::setprecision(1)
+            << input_bytes / seconds / (1024 * 1024) << " MB/s, "
+            << std::setprecision(1) << seconds * 1e9 / tokens << " ns/token, "
+            << "count only " << input_bytes / counting_seconds / (1024 * 1024) << " MB/s, "
+            << "structure index " << input_bytes / structure_seconds / (1024 * 1024) << " MB/s, "
+            << "line cache " << input_bytes / cached_seconds / (1024 * 1024) << " MB/s "
+            << "(" << std::setprecision(0) << 100 * cache_stats.hit_rate() << "% hits)"
+            << std::endl;
+        if (counters.available()) {
+            PerfCounts tokenize_counts = count_events(counters, [&]() {
+                bench_sink += Tokenizer(contents).size();
+            });
+            PerfCounts counting_counts = count_events(counters, [&]() {
+                bench_sink += BasicTokenizer<CountingSink>(contents).get_sink().total;
+            });
+            print_perf_report(std::cout, "tokenize", tokenize_counts, tokens, input_bytes);
+            print_perf_report(std::cout, "count only", counting_counts, tokens, input_bytes);
+        }
+        if (allocation_tracking_enabled()) {
+            print_allocation_report(std::cout, before, after, tokens, input_bytes);
+            std::cout << "count only: ";
+            print_allocation_report(std::cout, counting_before, counting_after, tokens, input_bytes);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *  @brief Stand-in for a parser, formats every Token.
+**/
+size_t consume_tokens(const std::vector<Token>& tokens) {
+    std::ostringstream os;
+    for (const Token& t : tokens) {
+        os << t << '\n';
+    }
+    return os.str().size();
+}
+
+/**
+ *  @brief Tokenize + consume one after the other vs through a TokenPipeline,
+ *  for a range of batch sizes.
+**/
+int bench_pipeline(const std::vector<std::string>& fnames) {
+    for (const std::string& fname : fnames) {
+        if (!file_exists(fname)) {
+            std::cout << "No file named \"" << fname << "\"" << std::endl;
+            return 1;
+        }
+        std::vector<std::string> contents = read_lines(fname);
+        std::vector<Token> tokens;
+
+        double tokenize = best_of(3, [&]() {
+            Tokenizer tokenizer(contents);
+            tokens = tokenizer.get_sink().tokens;
+        });
+        double consume = best_of(3, [&]() {
+            bench_sink += consume_tokens(tokens);
+        });
+        double sequential = best_of(3, [&]() {
+            Tokenizer tokenizer(contents);
+            bench_sink += consume_tokens(tokenizer.get_sink().tokens);
+        });
+
+        std::cout
+            << fname << ": " << std::fixed << std::setprecision(2)
+            << "tokenize " << tokenize * 1e3 << " ms, "
+            << "consume " << consume * 1e3 << " ms, "
+            << "sequential " << sequential * 1e3 << " ms"
+            << std::endl;
+
+        for (size_t batch_size : {16, 64, 256, 1024, 4096}) {
+            double pipelined = best_of(3, [&]() {
+                TokenPipeline pipeline(contents, batch_size);
+                std::vector<Token> batch;
+                while (pipeline.next_batch(batch)) {
+                    bench_sink += consume_tokens(batch);
+                }
+            });
+            std::cout
+                << "  pipelined, batch " << std::setw(5) << batch_size << ": "
+                << pipelined * 1e3 << " ms ("
+                << std::setprecision(0) << 100 * pipelined / std::max(tokenize, consume)
+                << std::setprecision(2) << "% of max(tokenize, consume))"
+                << std::endl;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *  @brief Reading only, tokenizing only, both one after the other, and
+ *  tokenize_batch with each FileLoader backend. With the reads overlapped
+ *  the batch should approach max(read, tokenize) instead of their sum.
+ *  Run on cold caches (echo 3 > /proc/sys/vm/drop_caches) to see the I/O side.
+**/
+int bench_batch(const std::vector<std::string>& fnames) {
+    for (const std::string& fname : fnames) {
+        if (!file_exists(fname)) {
+            std::cout << "No file named \"" << fname << "\"" << std::endl;
+            return 1;
+        }
+    }
+
+    std::string backend;
+    double read = best_of(3, [&]() {
+        FileLoader loader(fnames);
+        LoadedFile file;
+        while (loader.next(file)) {
+            bench_sink += file.contents.size();
+        }
+        backend = loader.backend();
+    });
+
+    std::vector<std::vector<std::string>> contents;
+    for (const std::string& fname : fnames) {
+        contents.push_back(read_lines(fname));
+    }
+    double tokenize = best_of(3, [&]() {
+        for (const std::vector<std::string>& lines : contents) {
+            bench_sink += Tokenizer(lines).size();
+        }
+    });
+    double sequential = best_of(3, [&]() {
+        for (const std::string& fname : fnames) {
+            bench_sink += Tokenizer(read_lines(fname)).size();
+        }
+    });
+
+    std::cout
+        << fnames.size() << " files: " << std::fixed << std::setprecision(2)
+        << "read (" << backend << ") " << read * 1e3 << " ms, "
+        << "tokenize " << tokenize * 1e3 << " ms, "
+        << "sequential " << sequential * 1e3 << " ms"
+        << std::endl;
+
+    size_t max_workers = std::max(1u, std::thread::hardware_concurrency());
+    for (bool io_uring : {true, false}) {
+        for (size_t workers : {(size_t)1, max_workers}) {
+            BatchOptions options;
+            options.workers = workers;
+            options.loader.io_uring = io_uring;
+
+            BatchStats stats;
+            double batch = best_of(3, [&]() {
+                stats = tokenize_batch(fnames, options, [](const LoadedFile&, const std::vector<Token>& tokens, const std::string&, bool) {
+                    bench_sink += tokens.size();
+                });
+            });
+
+            std::cout
+                << "  batch, " << std::setw(8) << stats.backend << ", " << workers << " workers: "
+                << batch * 1e3 << " ms ("
+                << std::setprecision(0) << 100 * batch / std::max(read, tokenize / workers)
+                << std::setprecision(2) << "% of max(read, tokenize / workers)), "
+                << stats.failed << " failed"
+                << std::endl;
+
+            if (workers == max_workers) {
+                break;
+            }
+        }
+    }
+
+    // NOTE: same batch under a memory budget, peak RSS is of the whole run so far
+    for (size_t budget_mb : {(size_t)256, (size_t)16}) {
+        BatchOptions options;
+        options.workers = max_workers;
+        options.memory_budget = budget_mb * 1024 * 1024;
+
+        BatchStats stats;
+        double batch = best_of(3, [&]() {
+            stats = tokenize_batch(fnames, options, [](const LoadedFile&, const std::vector<Token>& tokens, const std::string&, bool) {
+                bench_sink += tokens.size();
+            });
+        });
+
+        std::cout
+            << "  batch, budget " << budget_mb << " MB: "
+            << batch * 1e3 << " ms, estimated peak " << stats.estimated_peak / (1024 * 1024) << " MB, "
+            << "peak RSS " << stats.peak_rss / (1024 * 1024) << " MB, "
+            << stats.streamed << " files streamed"
+            << std::endl;
+    }
+
+    return 0;
+}
+
+struct AdversarialInput {
+    std::string name;
+    std::vector<std::string> lines;
+};
+
+/**
+ *  @brief Builds the adversarial corpus, inputs that used to be quadratic or
+ *  blow the stack: huge single lines, deep brackets, deep indentation and
+ *  strings that never close. Deterministic, so runs can be compared.
+ *  @param size approximate size of each input in bytes.
+**/
+std::vector<AdversarialInput> build_adversarial_corpus(size_t size) {
+    const std::string base64_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::mt19937 rng(1234);
+    std::vector<AdversarialInput> corpus;
+
+    std::string names = "x = [a0";
+    for (int i=1; names.size() < size; i++) {
+        names += ", a" + std::to_string(i);
+    }
+    corpus.push_back({"long line of names", {names + "]"}});
+
+    std::string blob = "data = \"";
+    while (blob.size() < size) {
+        blob += base64_chars[rng() % base64_chars.size()];
+    }
+    corpus.push_back({"base64 string", {blob + "==\""}});
+
+    // NOTE: unquoted base64 is a long run of NAME/NUMBER/OP Tokens
+    std::string bare = "data = ";
+    while (bare.size() < size) {
+        bare += base64_chars[rng() % base64_chars.size()];
+    }
+    corpus.push_back({"base64 bare", {bare + "=="}});
+
+    corpus.push_back({"long comment", {"# " + std::string(size, 'x')}});
+
+    std::string number = "x = 1";
+    while (number.size() < size) {
+        number += "234,567.";
+    }
+    corpus.push_back({"long number", {number + "8"}});
+
+    std::string escapes = "s = '";
+    while (escapes.size() < size) {
+        escapes += "\\'\\\\";
+    }
+    corpus.push_back({"escaped quotes", {escapes + "'"}});
+
+    size_t depth = size / 2;
+    corpus.push_back({"deep brackets", {"x = " + std::string(depth, '(') + "1" + std::string(depth, ')')}});
+
+    // NOTE: one more space per line, so sum(levels) bytes for levels INDENTs
+    std::vector<std::string> indents;
+    size_t indent_bytes = 0;
+    for (int level=0; indent_bytes < size; level++) {
+        indents.push_back(std::string(level, ' ') + "if x:");
+        indent_bytes += level + 6;
+    }
+    indents.push_back(std::string(indents.size(), ' ') + "pass");
+    corpus.push_back({"deep indentation", indents});
+
+    std::vector<std::string> open_triple{"s = \"\"\"never closed"};
+    for (size_t bytes=0; bytes < size; bytes += 41) {
+        open_triple.push_back("    text that stays inside the string \\\"");
+    }
+    corpus.push_back({"unterminated triple string", open_triple});
+
+    corpus.push_back({"unterminated string", {"s = \"" + std::string(size, 'x')}});
+
+    return corpus;
+}
+
+/**
+ *  @brief Tokenizes every input of the adversarial corpus at size and 4*size.
+ *  Fails if the cost per byte goes over max_ns_per_byte, or grows by more
+ *  than 2x when the input gets 4x bigger (it doesn't scale linearly).
+ *  @param max_ns_per_byte per byte threshold, checked at both sizes.
+ *  @returns 0 if every input passed, 1 otherwise.
+**/
+int bench_adversarial(double max_ns_per_byte) {
+    const size_t size = 256 * 1024;
+    std::vector<AdversarialInput> small = build_adversarial_corpus(size);
+    std::vector<AdversarialInput> large = build_adversarial_corpus(4 * size);
+    int failed = 0;
+
+    for (size_t i=0; i < small.size(); i++) {
+        double ns_per_byte[2];
+        int j = 0;
+
+        for (const AdversarialInput* input : {&small[i], &large[i]}) {
+            size_t input_bytes = 0;
+            for (const std::string& line : input->lines) {
+                input_bytes += line.size() + 1;
+            }
+
+            double seconds = best_of(3, [&]() {
+                try {
+                    bench_sink += BasicTokenizer<CountingSink>(input->lines).get_sink().total;
+                }
+                catch (const std::runtime_error&) {
+                    // NOTE: invalid inputs count too, the error has to be found in linear time
+                    bench_sink += 1;
+                }
+            });
+            ns_per_byte[j++] = seconds * 1e9 / input_bytes;
+        }
+
+        bool passed =
+            ns_per_byte[0] <= max_ns_per_byte &&
+            ns_per_byte[1] <= max_ns_per_byte &&
+            ns_per_byte[1] <= 2 * std::max(ns_per_byte[0], 1.0);  // NOTE: timer noise on the fast inputs
+        failed += !passed;
+
+        std::cout
+            << std::left << std::setw(28) << small[i].name
+            << std::right << std::fixed << std::setprecision(2)
+            << std::setw(8) << ns_per_byte[0] << " ns/byte"
+            << std::setw(8) << ns_per_byte[1] << " ns/byte at 4x"
+            << (passed ? "" : "  FAILED")
+            << std::endl;
+    }
+
+    if (failed > 0) {
+        std::cout << failed << " inputs over " << max_ns_per_byte << " ns/byte or not linear" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ *  @brief How long after a deadline, or after cancel is set, the tokenizer
+ *  actually returns, for every input of the adversarial corpus.
+ *  @param budget_ms deadline/cancel delay in milliseconds.
+**/
+int bench_deadline(double budget_ms) {
+    auto budget = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double, std::milli>(budget_ms)
+    );
+
+    for (const AdversarialInput& input : build_adversarial_corpus(1024 * 1024)) {
+        double late_ms[2];
+
+        for (int cancel=0; cancel < 2; cancel++) {
+            std::atomic<bool> cancelled(false);
+            TokenizerOptions options;
+            std::thread canceller;
+            auto start = std::chrono::steady_clock::now();
+
+            if (cancel) {
+                options.cancel = &cancelled;
+                canceller = std::thread([&]() {
+                    std::this_thread::sleep_until(start + budget);
+                    cancelled.store(true);
+                });
+            }
+            else {
+                options.deadline = start + budget;
+            }
+
+            try {
+                bench_sink += BasicTokenizer<CountingSink>(input.lines, CountingSink(), options).get_sink().total;
+            }
+            catch (const std::runtime_error&) {
+                bench_sink += 1;
+            }
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            late_ms[cancel] = std::max(0.0, elapsed.count() - budget_ms);
+
+            if (canceller.joinable()) {
+                canceller.join();
+            }
+        }
+
+        std::cout
+            << std::left << std::setw(28) << input.name
+            << std::right << std::fixed << std::setprecision(3)
+            << " deadline +" << late_ms[0] << " ms"
+            << ", cancel +" << late_ms[1] << " ms"
+            << std::endl;
+    }
+
+    return 0;
+}
+
+/**
+ *  @brief Cost of a TraceSpan before and after trace_enable(), then the
+ *  Tokenizer with a span per run to show the disabled ones don't register.
+**/
+int bench_trace() {
+    const int spans = 1000000;
+    std::vector<std::string> contents(200, "x = foo(a, b) + [1, 2, 3]");
+
+    double tokenize = best_of(5, [&]() {
+        bench_sink += Tokenizer(contents).size();
+    });
+    double disabled = best_of(5, [&]() {
+        for (int i=0; i < spans; i++) {
+            TraceSpan span("bench");
+        }
+    });
+    double tokenize_disabled = best_of(5, [&]() {
+        TraceSpan span("tokenize");
+        bench_sink += Tokenizer(contents).size();
+    });
+
+    trace_enable();
+    double enabled = best_of(1, [&]() {
+        for (int i=0; i < spans; i++) {
+            TraceSpan span("bench");
+        }
+    });
+
+    std::cout
+        << std::fixed << std::setprecision(2)
+        << "disabled span " << disabled * 1e9 / spans << " ns, "
+        << "enabled span " << enabled * 1e9 / spans << " ns, "
+        << "tokenize " << tokenize * 1e6 << " us, "
+        << "tokenize in a disabled span " << tokenize_disabled * 1e6 << " us"
+        << std::endl;
+
+    return 0;
+}
+
+/**
+ *  @brief Copy of lines with edits scattered through it: every
+ *  every'th line on average gets a comment, a line inserted after it or is deleted.
+**/
+std::vector<std::string> edit_lines(const std::vector<std::string>& lines, size_t every) {
+    std::mt19937 rng(1234);
+    std::vector<std::string> edited;
+
+    for (size_t i=0; i < lines.size(); i++) {
+        if (every == 0 || rng() % every != 0) {
+            edited.push_back(lines[i]);
+            continue;
+        }
+        switch (rng() % 3) {
+            case 0:
+                edited.push_back(lines[i] + "  # edited");
+                break;
+            case 1:
+                edited.push_back(lines[i]);
+                edited.push_back(lines[i].substr(0, lines[i].find_first_not_of(' ')) + "inserted = 1");
+                break;
+            default:
+                // NOTE: deleted, unless that would leave a block without its header
+                if (!lines[i].empty() && lines[i].back() == ':') {
+                    edited.push_back(lines[i]);
+                }
+                break;
+        }
+    }
+
+    return edited;
+}
+
+/**
+ *  @brief Fingerprinting (tokenizing with a FingerprintSink) and diff_tokens
+ *  over a ~100k Token input against copies with more and more edits, and
+ *  against an unrelated input.
+**/
+int bench_diff() {
+    // NOTE: adds up to ~100k Tokens, indentation resets after every block
+    std::vector<std::string> lines;
+    for (int i=0; lines.size() < 9500; i++) {
+        lines.push_back("def function_" + std::to_string(i) + "(a, b=None, *args):");
+        lines.push_back("    if a is not None and b:");
+        lines.push_back("        return [x * 2 for x in args if x == a]  # doubled");
+        lines.push_back("    value = {'key': a, 'other': (b, " + std::to_string(i) + ")}");
+        lines.push_back("    return value");
+        lines.push_back("");
+    }
+    std::vector<uint64_t> old_fingerprints = BasicTokenizer<FingerprintSink>(lines).get_sink().fingerprints;
+
+    size_t bytes = 0;
+    for (const std::string& line : lines) {
+        bytes += line.size() + 1;
+    }
+    double fingerprint = best_of(5, [&]() {
+        bench_sink += BasicTokenizer<FingerprintSink>(lines).get_sink().fingerprints.size();
+    });
+    double tokenize = best_of(5, [&]() {
+        bench_sink += Tokenizer(lines).size();
+    });
+    std::cout
+        << old_fingerprints.size() << " tokens, "
+        << std::fixed << std::setprecision(2)
+        << "fingerprint " << fingerprint * 1e3 << " ms, "
+        << "tokenize " << tokenize * 1e3 << " ms"
+        << std::endl;
+
+    struct DiffInput {
+        std::string name;
+        std::vector<std::string> lines;
+    };
+    std::vector<DiffInput> inputs = {
+        {"identical", lines},
+        {"edits 1/1000 lines", edit_lines(lines, 1000)},
+        {"edits 1/100 lines", edit_lines(lines, 100)},
+        {"edits 1/10 lines", edit_lines(lines, 10)},
+        {"unrelated", std::vector<std::string>(lines.rbegin(), lines.rend())},
+    };
+
+    for (const DiffInput& input : inputs) {
+        std::vector<uint64_t> new_fingerprints = BasicTokenizer<FingerprintSink>(input.lines).get_sink().fingerprints;
+        size_t edits = 0;
+        double seconds = best_of(5, [&]() {
+            edits = diff_tokens(old_fingerprints, new_fingerprints).size();
+        });
+
+        std::cout
+            << std::left << std::setw(28) << input.name
+            << std::right << std::setw(8) << edits << " edits"
+            << std::fixed << std::setprecision(3) << std::setw(10) << seconds * 1e3 << " ms"
+            << std::endl;
+    }
+
+    return 0;
+}
+
+/**
+ *  @brief Builds a TokenIndex of fnames, then times queries against it vs
+ *  tokenizing every file again and scanning its Tokens.
+**/
+int bench_index(const std::vector<std::string>& fnames) {
+    for (const std::string& fname : fnames) {
+        if (!file_exists(fname)) {
+            std::cout << "No file named \"" << fname << "\"" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::vector<std::string>> contents;
+    size_t bytes = 0;
+    for (const std::string& fname : fnames) {
+        contents.push_back(read_lines(fname));
+        for (const std::string& line : contents.back()) {
+            bytes += line.size() + 1;
+        }
+    }
+
+    // NOTE: files that don't tokenize are left out of the index and the scan
+    auto fingerprint = [](const std::vector<std::string>& lines, FingerprintSink& sink) {
+        try {
+            sink = std::move(BasicTokenizer<FingerprintSink>(lines).get_sink());
+            return true;
+        }
+        catch (const std::exception&) {
+            return false;
+        }
+    };
+
+    const std::string index_fname = "regex-tokenizer-bench.idx";
+    double build = best_of(1, [&]() {
+        TokenIndexBuilder builder;
+        for (size_t i=0; i < fnames.size(); i++) {
+            FingerprintSink sink;
+            if (fingerprint(contents[i], sink)) {
+                builder.add_file(fnames[i], sink);
+            }
+        }
+        builder.write(index_fname);
+    });
+
+    std::ifstream index_file(index_fname, std::ios::binary | std::ios::ate);
+    size_t index_bytes = index_file.tellg();
+    index_file.close();
+
+    double open = best_of(5, [&]() {
+        bench_sink += TokenIndex(index_fname).file_count();
+    });
+    std::unique_ptr<TokenIndex> index(new TokenIndex(index_fname));
+
+    std::cout
+        << index->file_count() << " files, " << bytes / 1024 << " KB, "
+        << std::fixed << std::setprecision(2)
+        << "build " << build * 1e3 << " ms, "
+        << "index " << index_bytes / 1024 << " KB (" << index->trigram_count() << " trigrams), "
+        << "open " << open * 1e6 << " us"
+        << std::endl;
+
+    std::vector<std::string> queries = {
+        "import os",
+        "self . NAME = NAME",
+        "raise ValueError ( STRING )",
+        "for NAME in range ( len (",
+        "NAME ( NAME ) [ NUMBER ]",
+        "if __name__ == STRING :",
+    };
+    for (const std::string& text : queries) {
+        std::vector<QueryToken> query = parse_token_query(text);
+        size_t matches = 0;
+        double indexed = best_of(5, [&]() {
+            matches = index->find(query).size();
+        });
+
+        size_t scanned_matches = 0;
+        double scan = best_of(1, [&]() {
+            scanned_matches = 0;
+            for (const std::vector<std::string>& lines : contents) {
+                FingerprintSink sink;
+                if (!fingerprint(lines, sink)) {
+                    continue;
+                }
+                for (size_t t=0; t + query.size() <= sink.kinds.size(); t++) {
+                    size_t i = 0;
+                    while (
+                        i < query.size() &&
+                        sink.kinds[t + i] == (uint8_t)query[i].kind &&
+                        (query[i].any_value || sink.fingerprints[t + i] == query[i].fingerprint)
+                    ) {
+                        i++;
+                    }
+                    scanned_matches += i == query.size();
+                }
+            }
+        });
+        if (scanned_matches != matches) {
+            std::cout << "\"" << text << "\": index found " << matches << ", scan " << scanned_matches << std::endl;
+            std::remove(index_fname.c_str());
+            return 1;
+        }
+
+        std::cout
+            << std::left << std::setw(32) << text
+            << std::right << std::setw(8) << matches << " matches"
+            << std::fixed << std::setprecision(3)
+            << std::setw(10) << indexed * 1e3 << " ms indexed"
+            << std::setw(10) << scan * 1e3 << " ms scan"
+            << std::endl;
+    }
+
+    index.reset();
+    std::remove(index_fname.c_str());
+    return 0;
+}
+
+/**
+ *  @brief operator<< for Tokens before format_token, std::to_string for the
+ *  position and std::setw for the padding.
+**/
+void format_token_with_setw(std::ostream& os, const Token& token) {
+    char quote_char = token.get_quotes();
+    std::string pos =
+        std::to_string(token.line_start) + "," +
+        std::to_string(token.column_start) + "-" +
+        std::to_string(token.line_end) + "," +
+        std::to_string(token.column_end) + ":";
+    std::string val = quote_char + std::string(token.text()) + quote_char;
+    int val_padding = std::max(0, 15 - utf8_width(val));
+
+    os << std::left << std::setw(20) << pos
+       << std::left << std::setw(15) << token.type
+       << val << std::string(val_padding, ' ');
+}
+
+/**
+ *  @brief Formatting every Token of fnames (or of a generated input) the old
+ *  std::setw way, through operator<<, as_string and format_token into one
+ *  reused buffer. Fails if format_token's output differs from the old one.
+**/
+int bench_format(const std::vector<std::string>& fnames) {
+    std::vector<Token> tokens;
+    for (const std::string& fname : fnames) {
+        if (!file_exists(fname)) {
+            std::cout << "No file named \"" << fname << "\"" << std::endl;
+            return 1;
+        }
+        std::vector<Token> file_tokens = std::move(Tokenizer(read_lines(fname)).get_sink().tokens);
+        tokens.insert(tokens.end(), file_tokens.begin(), file_tokens.end());
+    }
+    if (fnames.empty()) {
+        std::vector<std::string> lines;
+        for (int i=0; i < 2000; i++) {
+            lines.push_back("def function_" + std::to_string(i) + "(a, b=None, *args):");
+            lines.push_back("    return {'key': a, 'other': (b, " + std::to_string(i) + ")}  # é");
+        }
+        tokens = std::move(Tokenizer(lines).get_sink().tokens);
+    }
+
+    std::ostringstream expected;
+    for (const Token& t : tokens) {
+        format_token_with_setw(expected, t);
+        expected << '\n';
+    }
+    std::string formatted;
+    for (const Token& t : tokens) {
+        append_formatted_token(formatted, t);
+        formatted += '\n';
+    }
+    if (formatted != expected.str()) {
+        std::cout << "format_token output differs from the std::setw version" << std::endl;
+        return 1;
+    }
+
+    struct FormatMethod {
+        std::string name;
+        std::function<size_t()> run;
+    };
+    std::vector<FormatMethod> methods = {
+        {"to_string + setw (before)", [&]() {
+            std::ostringstream os;
+            for (const Token& t : tokens) {
+                format_token_with_setw(os, t);
+                os << '\n';
+            }
+            return os.str().size();
+        }},
+        {"operator<<", [&]() {
+            std::ostringstream os;
+            for (const Token& t : tokens) {
+                os << t << '\n';
+            }
+            return os.str().size();
+        }},
+        {"as_string", [&]() {
+            size_t bytes = 0;
+            for (Token& t : tokens) {
+                bytes += t.as_string().size() + 1;
+            }
+            return bytes;
+        }},
+        {"format_token", [&]() {
+            // NOTE: one buffer for every Token, like Tokenizer::print
+            char buffer[64 * 1024];
+            size_t bytes = 0;
+            size_t used = 0;
+            for (const Token& t : tokens) {
+                if (used + format_token_bound(t) + 1 > sizeof(buffer)) {
+                    bytes += used;
+                    used = 0;
+                }
+                used += format_token(t, buffer + used, sizeof(buffer) - used);
+                buffer[used++] = '\n';
+            }
+            return bytes + used;
+        }},
+    };
+
+    std::cout << tokens.size() << " tokens, " << formatted.size() / 1024 << " KB formatted" << std::endl;
+    for (const FormatMethod& method : methods) {
+        AllocationStats before = get_allocation_stats();
+        bench_sink += method.run();
+        AllocationStats after = get_allocation_stats();
+
+        double seconds = best_of(5, [&]() {
+            bench_sink += method.run();
+        });
+        std::cout
+            << std::left << std::setw(28) << method.name
+            << std::right << std::fixed << std::setprecision(1)
+            << std::setw(8) << seconds * 1e9 / tokens.size() << " ns/token";
+        if (allocation_tracking_enabled()) {
+            std::cout
+                << std::setprecision(2)
+                << std::setw(8) << (double)(after.allocations - before.allocations) / tokens.size() << " allocations/token";
+        }
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
+
+/**
+ *  @brief Writes the adversarial corpus to directory, one .py file per input.
+**/
+int write_adversarial_corpus(const std::string& directory) {
+    for (const AdversarialInput& input : build_adversarial_corpus(256 * 1024)) {
+        std::string fname = input.name;
+        std::replace(fname.begin(), fname.end(), ' ', '-');
+        fname = directory + "/" + fname + ".py";
+
+        std::ofstream file(fname);
+        if (!file.is_open()) {
+            std::cout << "Could not write \"" << fname << "\"" << std::endl;
+            return 1;
+        }
+        for (const std::string& line : input.lines) {
+            file << line << '\n';
+        }
+        std::cout << fname << std::endl;
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 1) {
+        std::cout
+            << "usage: regex-tokenizer-bench identifiers" << std::endl
+            << "       regex-tokenizer-bench strings" << std::endl
+            << "       regex-tokenizer-bench tokenize [filenames...]" << std::endl
+            << "       regex-tokenizer-bench pipeline [filenames...]" << std::endl
+            << "       regex-tokenizer-bench adversarial [max ns/byte]" << std::endl
+            << "       regex-tokenizer-bench adversarial-corpus [directory]" << std::endl
+            << "       regex-tokenizer-bench deadline [budget ms]" << std::endl
+            << "       regex-tokenizer-bench trace" << std::endl
+            << "       regex-tokenizer-bench batch [filenames...]" << std::endl
+            << "       regex-tokenizer-bench diff" << std::endl
+            << "       regex-tokenizer-bench index [filenames...]" << std::endl
+            << "       regex-tokenizer-bench format [filenames...]" << std::endl;
+        return 0;
+    }
+
+    std::string mode = argv[1];
+    if (mode == "identifiers") {
+        return bench_identifiers();
+    }
+    if (mode == "strings") {
+        return bench_strings();
+    }
+    if (mode == "tokenize") {
+        return bench_tokenize(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    if (mode == "pipeline") {
+        return bench_pipeline(std::vector<std::string>(argv + 2, argv + argc));
+    }
+
+    if (mode == "adversarial") {
+        // NOTE: the slowest input, deep brackets, runs at about 65 ns/byte, so
+        // the default fails once it gets 2x slower
+        return bench_adversarial(argc > 2 ? std::stod(argv[2]) : 120);
+    }
+    if (mode == "batch") {
+        return bench_batch(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    if (mode == "trace") {
+        return bench_trace();
+    }
+    if (mode == "deadline") {
+        return bench_deadline(argc > 2 ? std::stod(argv[2]) : 1);
+    }
+    if (mode == "diff") {
+        return bench_diff();
+    }
+    if (mode == "index") {
+        return bench_index(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    if (mode == "format") {
+        return bench_format(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    if (mode == "adversarial-corpus") {
+        return write_adversarial_corpus(argc > 2 ? argv[2] : ".");
+    }
+
+    std::cout << "Unknown benchmark \"" << mode << "\"" << std::endl;
+    return 1;
+}
@@ -3,36 +3,498 @@
 #include <array>
 #include <memory>
 #include <stdio.h>
-#include <sstream>
 #include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
 #include "token.h"
 #include "regex-tokenizer.h"
 #include "util.h"
+#include "alloc-tracker.h"
+#include "interner.h"
+#include "token-pipeline.h"
+#include "line-cache.h"
+#include "structure-index.h"
+#include "trace.h"
+#include "batch-tokenizer.h"
+#include "memory-budget.h"
+#include "token-diff.h"
+#include "token-index.h"
 #include "unit-testing-util.h"
 
+// NOTE: regex-tokenizer-main [filenames...] [options]
+// more than one filename tokenizes them one after the other (batch mode)
+// -c  compare the output against 'python -m tokenize'
+// -a  print allocations made while reading + tokenizing to stderr,
+//     needs the allocation tracking build (make regex-tokenizer-main-alloc)
+// -i  intern NAME Tokens, one Interner is shared by every file
+// -p  pipelined, tokenize on a second thread while printing
+// -b  [size] Tokens per batch handed from the tokenizer thread with -p
+// -l  replay repeated lines from a line cache shared by every file
+// -t  [ms] stop tokenizing a file after ms milliseconds, printing the Tokens so far
+// -s  build a StructureIndex per file and print its size to stderr
+// --trace [out.json] write per file and per phase spans as Chrome trace events
+// -u  read the files in the background (io_uring, or pread threads) while
+//     tokenizing, output stays in filename order
+// -j  [workers] tokenizer threads with -u
+// -m  [MB] memory budget for -u, files too big for it are streamed, prints
+//     the peak RSS against the budget to stderr
+// -d  diff the Tokens of two files (old new), printing every TokenEdit
+//     as a hunk of token indices followed by the removed and added Tokens
+// --index [out.idx] tokenize the files once and write a TokenIndex of them
+// --query [index.idx] [query] print every match of a Token query in an index,
+//     e.g. "NAME . append (", see parse_token_query
+
+/**
+ *  @brief Prints the size of a StructureIndex to stderr.
+**/
+void print_structure_index(const std::string& fname, const StructureIndex& index) {
+	size_t brackets = 0;
+	for (uint32_t i=0; i < index.size(); i++) {
+		brackets += index.matching_bracket(i) > i && index.matching_bracket(i) != NO_TOKEN;
+	}
+
+	std::cerr
+		<< fname << ": " << index.logical_lines().size() << " logical lines, "
+		<< index.blocks().size() << " blocks, "
+		<< brackets << " bracket pairs"
+		<< std::endl;
+}
+
+/**
+ *  @brief Tokenizes fnames with tokenize_batch and prints them in order, each
+ *  as soon as it and every file before it are done.
+ *  @param memory_budget bytes, 0 for no limit, see BatchOptions.
+**/
+void print_batch(
+	const std::vector<std::string>& fnames,
+	size_t workers,
+	size_t memory_budget,
+	const TokenizerOptions& options
+) {
+	std::vector<std::string> outputs(fnames.size());
+	std::vector<size_t> charged(fnames.size(), 0);
+	std::vector<std::string> errors(fnames.size());
+	std::vector<bool> finished(fnames.size(), false);
+	size_t next_print = 0;
+	std::mutex print_mutex;
+	std::condition_variable printed;
+
+	BatchOptions batch_options;
+	batch_options.workers = workers;
+	batch_options.memory_budget = memory_budget;
+	batch_options.tokenizer = options;
+	// NOTE: output waiting for an earlier file is charged to the budget until
+	// it is printed, so it doesn't pile up outside of it. A streamed file's
+	// output would grow past its charge, it waits for its turn instead, which
+	// needs the files handed out in order (see BatchCallback)
+	MemoryBudget budget(memory_budget);
+	if (memory_budget > 0) {
+		batch_options.budget = &budget;
+		batch_options.loader.in_order = true;
+	}
+
+	BatchStats stats = tokenize_batch(fnames, batch_options, [&](
+		const LoadedFile& file,
+		const std::vector<Token>& tokens,
+		const std::string& error,
+		bool last
+	) {
+		if (!last) {
+			// NOTE: a streamed file's chunk, every file before it is being tokenized.
+			// Once it is next it stays next until its last chunk
+			std::unique_lock<std::mutex> lock(print_mutex);
+			printed.wait(lock, [&]() {
+				return file.index == next_print;
+			});
+		}
+
+		// NOTE: formatting is most of the time spent printing
+		TraceSpan span("print", file.fname);
+		std::string text;
+		for (const Token& t : tokens) {
+			append_formatted_token(text, t);
+			text += '\n';
+		}
+
+		std::lock_guard<std::mutex> lock(print_mutex);
+		if (file.index == next_print) {
+			// NOTE: nothing before it is left, don't hold on to the output
+			std::cout << text;
+		}
+		else {
+			outputs[file.index] += text;
+			if (memory_budget > 0) {
+				budget.force_acquire(text.size());
+				charged[file.index] += text.size();
+			}
+		}
+		if (!last) {
+			return;
+		}
+		errors[file.index] = error;
+		finished[file.index] = true;
+
+		while (next_print < fnames.size() && finished[next_print]) {
+			std::cout << outputs[next_print] << std::flush;
+			if (!errors[next_print].empty()) {
+				std::cerr << fnames[next_print] << ": " << errors[next_print] << std::endl;
+			}
+			outputs[next_print] = std::string();
+			budget.release(charged[next_print]);
+			charged[next_print] = 0;
+			next_print++;
+		}
+		printed.notify_all();
+	});
+
+	if (memory_budget > 0) {
+		std::cerr
+			<< "memory: peak RSS " << stats.peak_rss / (1024 * 1024) << " MB, "
+			<< "budget " << stats.memory_budget / (1024 * 1024) << " MB, "
+			<< "estimated peak " << stats.estimated_peak / (1024 * 1024) << " MB, "
+			<< stats.streamed << " of " << stats.files << " files streamed"
+			<< std::endl;
+	}
+}
+
+/**
+ *  @brief Tokenizes two versions of a file and prints the edits between
+ *  them, e.g.
+ *      @@ -12,3 +12,1 @@
+ *      - 2,4-2,5:          OP             '+'
+ *      ...
+ *      + 2,4-2,5:          OP             '-'
+**/
+void print_diff(const std::string& old_fname, const std::string& new_fname, const TokenizerOptions& options) {
+	std::vector<Token> old_tokens = std::move(Tokenizer(read_lines(old_fname), options).get_sink().tokens);
+	std::vector<Token> new_tokens = std::move(Tokenizer(read_lines(new_fname), options).get_sink().tokens);
+
+	std::vector<TokenEdit> edits;
+	{
+		TraceSpan span("diff");
+		edits = diff_tokens(old_tokens, new_tokens);
+	}
+
+	for (const TokenEdit& edit : edits) {
+		std::cout
+			<< "@@ -" << edit.old_tokens.begin << "," << edit.old_tokens.end - edit.old_tokens.begin
+			<< " +" << edit.new_tokens.begin << "," << edit.new_tokens.end - edit.new_tokens.begin
+			<< " @@" << std::endl;
+		for (uint32_t i=edit.old_tokens.begin; i < edit.old_tokens.end; i++) {
+			std::cout << "- " << old_tokens[i] << std::endl;
+		}
+		for (uint32_t i=edit.new_tokens.begin; i < edit.new_tokens.end; i++) {
+			std::cout << "+ " << new_tokens[i] << std::endl;
+		}
+	}
+}
+
+/**
+ *  @brief Tokenizes fnames and writes them as a TokenIndex, files that fail
+ *  to tokenize are reported to stderr and left out.
+**/
+void write_index(const std::vector<std::string>& fnames, const std::string& index_fname, const TokenizerOptions& options) {
+	TokenIndexBuilder builder;
+	for (const std::string& fname : fnames) {
+		TraceSpan span("index", fname);
+		try {
+			BasicTokenizer<FingerprintSink> tokenizer(read_lines(fname), FingerprintSink(), options);
+			builder.add_file(fname, tokenizer.get_sink());
+		}
+		catch (const std::exception& e) {
+			std::cerr << fname << ": " << e.what() << std::endl;
+		}
+	}
+
+	TraceSpan span("write index");
+	builder.write(index_fname);
+	std::cerr << "indexed " << builder.size() << " of " << fnames.size() << " files" << std::endl;
+}
+
+/**
+ *  @brief Prints every match of query in an index as fname:line: token N.
+**/
+void print_query(const std::string& index_fname, const std::string& query_text) {
+	TokenIndex index(index_fname);
+	std::vector<TokenIndexMatch> matches = index.find(parse_token_query(query_text));
+	for (const TokenIndexMatch& match : matches) {
+		std::cout << index.file_name(match.file) << ":" << match.line << ": token " << match.token << std::endl;
+	}
+}
+
 int main(int argc, char* argv[]) {
-	if (argc == 1) {
-		std::cout << "Missing input filename\n";
+	std::vector<std::string> fnames;
+	bool compare = false;
+	bool allocation_report = false;
+	bool intern = false;
+	bool pipeline = false;
+	bool cache_lines = false;
+	size_t batch_size = 256;
+	int timeout_ms = -1;
+	bool structure = false;
+	std::string trace_fname;
+	bool async_loading = false;
+	size_t workers = 1;
+	bool diff = false;
+	size_t memory_budget = 0;
+	std::string index_fname;
+	std::string query_index_fname;
+	std::string query;
+	for (int i=1; i < argc; i++) {
+		std::string option = argv[i];
+		if (option == "-c") {
+			compare = true;
+		}
+		else if (option == "-a") {
+			allocation_report = true;
+		}
+		else if (option == "-i") {
+			intern = true;
+		}
+		else if (option == "-l") {
+			cache_lines = true;
+		}
+		else if (option == "--trace" && i+1 < argc) {
+			trace_fname = argv[++i];
+		}
+		else if (option == "-u") {
+			async_loading = true;
+		}
+		else if (option == "-j" && i+1 < argc && is_number(argv[i+1])) {
+			workers = std::max(1, std::stoi(argv[++i]));
+		}
+		else if (option == "-m" && i+1 < argc && is_number(argv[i+1])) {
+			memory_budget = (size_t)std::max(1, std::stoi(argv[++i])) * 1024 * 1024;
+		}
+		else if (option == "--index" && i+1 < argc) {
+			index_fname = argv[++i];
+		}
+		else if (option == "--query" && i+2 < argc) {
+			query_index_fname = argv[++i];
+			query = argv[++i];
+		}
+		else if (option == "-d") {
+			diff = true;
+		}
+		else if (option == "-s") {
+			structure = true;
+		}
+		else if (option == "-p") {
+			pipeline = true;
+		}
+		else if (option == "-b" && i+1 < argc && is_number(argv[i+1])) {
+			batch_size = std::max(1, std::stoi(argv[++i]));
+		}
+		else if (option == "-t" && i+1 < argc && is_number(argv[i+1])) {
+			timeout_ms = std::stoi(argv[++i]);
+		}
+		else if (option.size() > 1 && option[0] == '-') {
+			std::cout << "Unknown option \"" << option << "\"" << std::endl;
+			return 0;
+		}
+		else {
+			fnames.push_back(option);
+		}
+	}
+
+	if (!query_index_fname.empty()) {
+		if (!file_exists(query_index_fname)) {
+			std::cout << "No file named \"" << query_index_fname << "\"" << std::endl;
+			return 0;
+		}
+		try {
+			print_query(query_index_fname, query);
+		}
+		catch (const std::exception& e) {
+			std::cout << e.what() << std::endl;
+		}
 		return 0;
 	}
 
-	if (!file_exists(argv[1])) {
-		std::cout
-			<< "No file named \""
-			<< argv[1]
-			<< "\""
-			<< std::endl;
+	if (fnames.size() == 0) {
+		std::cout << "Missing input filename\n";
 		return 0;
 	}
 
-	std::vector<std::string> contents = read_lines(argv[1]);
+	if (!trace_fname.empty()) {
+		trace_enable();
+		trace_set_thread_name("main");
+	}
+
+	Interner interner;
+	LineCache line_cache;
+	TokenizerOptions options;
+	if (intern) {
+		options.interner = &interner;
+	}
+	if (cache_lines) {
+		options.line_cache = &line_cache;
+	}
+	size_t names = 0;
+
+	if (diff) {
+		if (fnames.size() != 2) {
+			std::cout << "-d needs exactly two filenames" << std::endl;
+			return 0;
+		}
+		for (const std::string& fname : fnames) {
+			if (!file_exists(fname)) {
+				std::cout << "No file named \"" << fname << "\"" << std::endl;
+				return 0;
+			}
+		}
+		print_diff(fnames[0], fnames[1], options);
+		fnames.clear();
+	}
+
+	if (!index_fname.empty()) {
+		for (const std::string& fname : fnames) {
+			if (!file_exists(fname)) {
+				std::cout << "No file named \"" << fname << "\"" << std::endl;
+				return 0;
+			}
+		}
+		write_index(fnames, index_fname, options);
+		fnames.clear();
+	}
+
+	if (async_loading) {
+		for (const std::string& fname : fnames) {
+			if (!file_exists(fname)) {
+				std::cout << "No file named \"" << fname << "\"" << std::endl;
+				return 0;
+			}
+		}
+		print_batch(fnames, workers, memory_budget, options);
+		fnames.clear();
+	}
+
+	for (const std::string& fname : fnames) {
+		TraceSpan file_span("file", fname);
+
+		if (!file_exists(fname)) {
+			std::cout
+				<< "No file named \""
+				<< fname
+				<< "\""
+				<< std::endl;
+			return 0;
+		}
+
+		StructureIndex structure_index;
+		if (structure) {
+			options.structure = &structure_index;
+		}
+
+		if (timeout_ms >= 0) {
+			options.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+		}
 
-	Tokenizer tokenizer(contents);
+		if (pipeline) {
+			std::vector<std::string> contents;
+			{
+				TraceSpan span("read_lines");
+				contents = read_lines(fname);
+			}
+			TokenPipeline token_pipeline(std::move(contents), batch_size, 64, options);
+			std::vector<Token> batch;
+			{
+				// NOTE: formatted into one buffer like Tokenizer::print, a write and
+				// flush per batch instead of per Token
+				TraceSpan span("print");
+				std::string buffer;
+				while (token_pipeline.next_batch(batch)) {
+					buffer.clear();
+					for (const Token& t : batch) {
+						append_formatted_token(buffer, t);
+						buffer += '\n';
+						names += t.name_id != NO_NAME_ID;
+					}
+					std::cout.write(buffer.data(), buffer.size());
+					std::cout.flush();
+				}
+			}
+			if (token_pipeline.get_status() != TokenizeStatus::COMPLETE) {
+				std::cerr << fname << ": truncated (" << tokenize_status_name(token_pipeline.get_status()) << ")" << std::endl;
+			}
+			if (structure) {
+				print_structure_index(fname, structure_index);
+			}
+			if (compare) {
+				TraceSpan span("compare");
+				(void)compare_tokenization_results(fname, false);
+			}
+			continue;
+		}
 
-	tokenizer.print();
+		reset_allocation_peak();
+		AllocationStats before = get_allocation_stats();
+
+		std::vector<std::string> contents;
+		{
+			TraceSpan span("read_lines");
+			contents = read_lines(fname);
+		}
+
+		Tokenizer tokenizer = [&]() {
+			TraceSpan span("tokenize");
+			return Tokenizer(contents, options);
+		}();
+
+		AllocationStats after = get_allocation_stats();
+
+		{
+			TraceSpan span("print");
+			tokenizer.print();
+		}
+		if (tokenizer.get_status() != TokenizeStatus::COMPLETE) {
+			std::cerr << fname << ": truncated (" << tokenize_status_name(tokenizer.get_status()) << ")" << std::endl;
+		}
+
+		if (allocation_report) {
+			size_t input_bytes = 0;
+			for (const std::string& line : contents) {
+				input_bytes += line.size() + 1;
+			}
+			print_allocation_report(std::cerr, before, after, tokenizer.size(), input_bytes);
+		}
+
+		if (structure) {
+			print_structure_index(fname, structure_index);
+		}
+
+		if (intern) {
+			for (int i=0; i < tokenizer.size(); i++) {
+				names += tokenizer.at(i).name_id != NO_NAME_ID;
+			}
+		}
+
+		if (compare) {
+			TraceSpan span("compare");
+			(void)compare_tokenization_results(fname, false);
+		}
+	}
+
+	if (intern) {
+		std::cerr
+			<< "interned " << interner.size() << " distinct names from "
+			<< names << " NAME tokens, "
+			<< interner.arena_bytes() << " bytes of name data"
+			<< std::endl;
+	}
+
+	if (cache_lines) {
+		LineCacheStats stats = line_cache.stats();
+		std::cerr
+			<< "line cache: " << stats.hits << " hits / " << stats.lookups << " lookups ("
+			<< (int)(100 * stats.hit_rate()) << "%), "
+			<< stats.lines << " lines cached"
+			<< std::endl;
+	}
 
-	if (argc == 3 && argv[2] == (std::string)"-c") {
-		(void)compare_tokenization_results(argv[1], false);
+	if (!trace_fname.empty() && !trace_write(trace_fname)) {
+		std::cerr << "Could not write \"" << trace_fname << "\"" << std::endl;
 	}
 
 	return 0;
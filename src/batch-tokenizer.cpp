@@ -0,0 +1,194 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <exception>
+#include <algorithm>
+#include <sys/resource.h>
+#include "util.h"
+#include "trace.h"
+#include "token.h"
+#include "token-sink.h"
+#include "file-loader.h"
+#include "memory-budget.h"
+#include "regex-tokenizer.h"
+#include "batch-tokenizer.h"
+
+// NOTE: peak heap while reading + tokenizing a file, as a multiple of its
+// size. regex-tokenizer-main-alloc -a shows 25-130x for real code, the Token
+// vector (120 byte Tokens, up to 2x capacity while it grows) dominates.
+// Token dense inputs like deep brackets go past 300x, the estimate is for
+// typical code, not a bound.
+const size_t PEAK_BYTES_PER_BYTE = 128;
+// NOTE: a streamed file holds its contents, the line being tokenized and one
+// chunk of Tokens. The alloc tracker measures 1.03-1.10x on 5.8-19MB files
+// plus the chunk, 2x leaves room for long lines.
+const size_t STREAMING_BYTES_PER_BYTE = 2;
+const size_t PER_FILE_BYTES = 64 * 1024;
+
+/**
+ *  @brief Estimated peak memory of tokenizing a file into one Token vector.
+ *  @param file_bytes size of the file.
+**/
+size_t estimate_peak_bytes(size_t file_bytes) {
+    return PER_FILE_BYTES + PEAK_BYTES_PER_BYTE * file_bytes;
+}
+
+/**
+ *  @brief Estimated peak memory of tokenizing a file in chunks.
+ *  @param file_bytes size of the file.
+ *  @param chunk_tokens Tokens per chunk, see BatchOptions::stream_chunk.
+**/
+size_t estimate_streaming_peak_bytes(size_t file_bytes, size_t chunk_tokens) {
+    return PER_FILE_BYTES + STREAMING_BYTES_PER_BYTE * file_bytes + chunk_tokens * sizeof(Token);
+}
+
+/**
+ *  @returns The peak resident set size of the process in bytes, 0 if unknown.
+**/
+static size_t peak_rss_bytes() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return (size_t)usage.ru_maxrss * 1024;  // NOTE: kilobytes on Linux
+}
+
+/**
+ *  @brief Tokenizes a batch of files, reading them through a FileLoader while
+ *  options.workers threads tokenize the ones already read. With enough reads
+ *  in flight the batch takes about max(reading, tokenizing) instead of their sum.
+ *
+ *  With a memory_budget every file acquires its estimate_peak_bytes from a
+ *  MemoryBudget before it is read and gives it back once its callback
+ *  returned, so reading ahead and the workers together stay within the
+ *  budget. Memory the callback keeps past that has to be charged to
+ *  options.budget by the callback. Files estimated at more than
+ *  memory_budget / workers are streamed instead: read into the tokenizer one
+ *  line at a time, tokenized in stream_chunk sized pieces and charged
+ *  estimate_streaming_peak_bytes, so one huge file doesn't keep the other
+ *  workers waiting.
+ *  @param fnames files to tokenize.
+ *  @param options see BatchOptions.
+ *  @param callback gets every file with its Tokens, see BatchCallback.
+ *  @returns Counters for the whole batch.
+**/
+BatchStats tokenize_batch(
+    const std::vector<std::string>& fnames,
+    const BatchOptions& options,
+    const BatchCallback& callback
+) {
+    auto start = std::chrono::steady_clock::now();
+    size_t worker_count = std::max<size_t>(1, options.workers);
+
+    MemoryBudget own_budget(options.memory_budget);
+    MemoryBudget& budget = options.budget != nullptr ? *options.budget : own_budget;
+    auto streamed = [&](size_t file_bytes) {
+        return options.memory_budget > 0 && estimate_peak_bytes(file_bytes) > options.memory_budget / worker_count;
+    };
+
+    FileLoaderOptions loader_options = options.loader;
+    if (options.memory_budget > 0) {
+        loader_options.budget = &budget;
+        loader_options.footprint = [&](size_t file_bytes) {
+            return streamed(file_bytes)
+                ? estimate_streaming_peak_bytes(file_bytes, options.stream_chunk)
+                : estimate_peak_bytes(file_bytes);
+        };
+    }
+
+    FileLoader loader(fnames, loader_options);
+    BatchStats stats;
+    std::mutex stats_mutex;
+
+    auto work = [&](size_t worker) {
+        if (worker > 0) {
+            trace_set_thread_name("worker " + std::to_string(worker));
+        }
+        LoadedFile file;
+
+        while (loader.next(file)) {
+            std::vector<Token> tokens;
+            std::string error = file.error;
+            size_t bytes = file.contents.size();
+            size_t token_count = 0;
+            bool stream = error.empty() && streamed(bytes);
+
+            if (stream) {
+                TraceSpan span("tokenize (streamed)", file.fname);
+                std::string contents = std::move(file.contents);
+                file.contents = std::string();
+
+                // NOTE: lines are split off one at a time as the tokenizer gets to them
+                size_t line_start = 0;
+                LineReader read_line = [&](std::string& line) {
+                    if (line_start >= contents.size()) {
+                        return false;
+                    }
+                    size_t line_end = std::min(contents.find('\n', line_start), contents.size());
+                    line.assign(contents, line_start, line_end - line_start);
+                    line_start = line_end + 1;
+                    return true;
+                };
+                ChunkSink sink(std::max<size_t>(1, options.stream_chunk), [&](std::vector<Token>& chunk) {
+                    callback(file, chunk, "", false);
+                    token_count += chunk.size();
+                });
+                try {
+                    BasicTokenizer<ChunkSink> tokenizer(std::move(read_line), std::move(sink), options.tokenizer);
+                    tokens = std::move(tokenizer.get_sink().chunk);
+                }
+                catch (const std::exception& e) {
+                    error = e.what();
+                }
+            }
+            else if (error.empty()) {
+                TraceSpan span("tokenize", file.fname);
+                try {
+                    Tokenizer tokenizer(split_lines(file.contents), options.tokenizer);
+                    tokens = std::move(tokenizer.get_sink().tokens);
+                }
+                catch (const std::exception& e) {
+                    error = e.what();
+                }
+            }
+
+            if (!error.empty()) {
+                tokens.clear();
+            }
+            token_count += tokens.size();
+            callback(file, tokens, error, true);
+
+            // NOTE: the file's memory is gone once tokens is
+            tokens = std::vector<Token>();
+            file.contents = std::string();
+            budget.release(file.charged);
+
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            stats.files++;
+            stats.failed += !error.empty();
+            stats.streamed += stream;
+            stats.bytes += bytes;
+            stats.tokens += token_count;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i=1; i < worker_count; i++) {
+        workers.emplace_back(work, i);
+    }
+    work(0);  // NOTE: the calling thread is worker 0
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    stats.seconds = elapsed.count();
+    stats.backend = loader.backend();
+    stats.memory_budget = options.memory_budget;
+    stats.estimated_peak = budget.get_peak();
+    stats.peak_rss = peak_rss_bytes();
+
+    return stats;
+}
@@ -0,0 +1,64 @@
+#ifndef BATCH_TOKENIZER_H
+#define BATCH_TOKENIZER_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstddef>
+#include "token.h"
+#include "file-loader.h"
+#include "memory-budget.h"
+#include "regex-tokenizer.h"
+
+struct BatchOptions {
+    size_t workers = 1;           // NOTE: tokenizer threads
+    FileLoaderOptions loader;
+    TokenizerOptions tokenizer;   // NOTE: an Interner or LineCache in here is shared by every worker
+    size_t memory_budget = 0;     // NOTE: bytes, 0 for no limit, see tokenize_batch
+    // NOTE: admits files against memory_budget, made per batch if not set.
+    // Set it to charge memory the callback holds on to (e.g. output buffered
+    // until earlier files are done) with MemoryBudget::force_acquire, files
+    // then aren't read while it is held
+    MemoryBudget* budget = nullptr;
+    size_t stream_chunk = 4096;   // NOTE: Tokens per callback for a streamed file
+};
+
+struct BatchStats {
+    size_t files = 0;
+    size_t failed = 0;            // NOTE: files that couldn't be read or tokenized
+    size_t bytes = 0;
+    size_t tokens = 0;
+    double seconds = 0;
+    const char* backend = "";     // NOTE: see FileLoader::backend()
+    size_t streamed = 0;          // NOTE: files that went through the low memory path
+    size_t memory_budget = 0;
+    size_t estimated_peak = 0;    // NOTE: most estimated bytes admitted at once
+    size_t peak_rss = 0;          // NOTE: peak resident set size of the whole process, 0 if unknown
+};
+
+// NOTE: called on a worker thread for every file, in the order the files
+// finish loading. error is empty unless the file couldn't be read or tokenized,
+// tokens is empty then. A streamed file comes in several calls of up to
+// stream_chunk Tokens with an empty file.contents, last is only true on the
+// final call, which has the error if there is one. Every other file is one call.
+// Files are admitted in order, so when a file's callback runs every file
+// before it was admitted against the budget. With loader.in_order the workers
+// also take the files in order, every file before it is then being (or done)
+// tokenized, and a callback may wait for the callbacks of earlier files.
+using BatchCallback = std::function<void(
+    const LoadedFile& file,
+    const std::vector<Token>& tokens,
+    const std::string& error,
+    bool last
+)>;
+
+size_t estimate_peak_bytes(size_t file_bytes);
+size_t estimate_streaming_peak_bytes(size_t file_bytes, size_t chunk_tokens);
+
+BatchStats tokenize_batch(
+    const std::vector<std::string>& fnames,
+    const BatchOptions& options,
+    const BatchCallback& callback
+);
+
+#endif
@@ -0,0 +1,579 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "trace.h"
+#include "file-loader.h"
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+/**
+ *  @brief Opens fname for reading.
+ *  @param size gets the size of the file.
+ *  @param error gets the reason on failure.
+ *  @returns The file descriptor, or -1.
+**/
+static int open_for_reading(const std::string& fname, size_t& size, std::string& error) {
+    int fd = open(fname.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "could not open \"" + fname + "\": " + std::strerror(errno);
+        return -1;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        error = "could not stat \"" + fname + "\": " + std::strerror(errno);
+        close(fd);
+        return -1;
+    }
+    size = info.st_size;
+
+    return fd;
+}
+
+#ifdef __linux__
+
+// NOTE: the parts of io_uring this uses, written against the kernel ABI
+// (linux/io_uring.h) so there is no liburing dependency
+// https://kernel.dk/io_uring.pdf
+struct IoUring {
+    int fd = -1;
+
+    void* sq_ring = MAP_FAILED;
+    size_t sq_ring_size = 0;
+    unsigned* sq_tail = nullptr;
+    unsigned sq_mask = 0;
+    unsigned* sq_array = nullptr;
+    io_uring_sqe* sqes = (io_uring_sqe*)MAP_FAILED;
+    size_t sqes_size = 0;
+
+    void* cq_ring = MAP_FAILED;
+    size_t cq_ring_size = 0;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    std::vector<std::unique_ptr<char[]>> buffers;  // NOTE: registered with the kernel
+    size_t buffer_size = 0;
+};
+
+static void uring_close(IoUring& ring) {
+    if (ring.sqes != MAP_FAILED) {
+        munmap(ring.sqes, ring.sqes_size);
+    }
+    if (ring.cq_ring != MAP_FAILED && ring.cq_ring != ring.sq_ring) {
+        munmap(ring.cq_ring, ring.cq_ring_size);
+    }
+    if (ring.sq_ring != MAP_FAILED) {
+        munmap(ring.sq_ring, ring.sq_ring_size);
+    }
+    if (ring.fd >= 0) {
+        close(ring.fd);  // NOTE: also unregisters the buffers
+    }
+}
+
+/**
+ *  @brief Sets up an io_uring with buffer_count registered buffers.
+ *  @returns false if io_uring isn't available, ring is closed again then.
+**/
+static bool uring_open(IoUring& ring, size_t buffer_count, size_t buffer_size) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    ring.fd = syscall(__NR_io_uring_setup, (unsigned)buffer_count, &params);
+    if (ring.fd < 0) {
+        return false;
+    }
+
+    ring.sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring.cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring.sq_ring_size = ring.cq_ring_size = std::max(ring.sq_ring_size, ring.cq_ring_size);
+    }
+
+    ring.sq_ring = mmap(
+        nullptr, ring.sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        ring.fd, IORING_OFF_SQ_RING
+    );
+    if (ring.sq_ring == MAP_FAILED) {
+        uring_close(ring);
+        return false;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring.cq_ring = ring.sq_ring;
+    }
+    else {
+        ring.cq_ring = mmap(
+            nullptr, ring.cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ring.fd, IORING_OFF_CQ_RING
+        );
+        if (ring.cq_ring == MAP_FAILED) {
+            uring_close(ring);
+            return false;
+        }
+    }
+
+    ring.sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    ring.sqes = (io_uring_sqe*)mmap(
+        nullptr, ring.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        ring.fd, IORING_OFF_SQES
+    );
+    if (ring.sqes == MAP_FAILED) {
+        uring_close(ring);
+        return false;
+    }
+
+    char* sq = (char*)ring.sq_ring;
+    ring.sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ring.sq_mask = *(unsigned*)(sq + params.sq_off.ring_mask);
+    ring.sq_array = (unsigned*)(sq + params.sq_off.array);
+
+    char* cq = (char*)ring.cq_ring;
+    ring.cq_head = (unsigned*)(cq + params.cq_off.head);
+    ring.cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ring.cq_mask = *(unsigned*)(cq + params.cq_off.ring_mask);
+    ring.cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    // NOTE: registered buffers are pinned once instead of on every read
+    std::vector<iovec> iovecs(buffer_count);
+    ring.buffer_size = buffer_size;
+    for (size_t i=0; i < buffer_count; i++) {
+        ring.buffers.push_back(std::make_unique<char[]>(buffer_size));
+        iovecs[i].iov_base = ring.buffers[i].get();
+        iovecs[i].iov_len = buffer_size;
+    }
+    if (syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_BUFFERS, iovecs.data(), (unsigned)buffer_count) != 0) {
+        uring_close(ring);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ *  @brief Queues a read of len bytes at offset into registered buffer slot.
+ *  Only the loader thread touches the submission ring.
+**/
+static void uring_queue_read(IoUring& ring, unsigned slot, int fd, size_t len, size_t offset) {
+    unsigned tail = *ring.sq_tail;
+    unsigned index = tail & ring.sq_mask;
+
+    io_uring_sqe* sqe = &ring.sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ_FIXED;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)ring.buffers[slot].get();
+    sqe->len = len;
+    sqe->off = offset;
+    sqe->buf_index = slot;
+    sqe->user_data = slot;
+
+    ring.sq_array[index] = index;
+    // NOTE: release, the kernel must see the sqe before the new tail
+    __atomic_store_n(ring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+#else
+
+struct IoUring {};
+
+#endif
+
+/**
+ *  @brief FileLoader constructor. Starts reading fnames in the background.
+ *  @param fnames files to read.
+ *  @param options see FileLoaderOptions.
+**/
+FileLoader::FileLoader(std::vector<std::string> fnames, const FileLoaderOptions& options)
+    : fnames(std::move(fnames)), options(options), next_file(0), stopped(false), uring(false), handed_out(0) {
+    this->options.in_flight = std::max<size_t>(1, this->options.in_flight);
+    this->options.buffer_size = std::max<size_t>(4096, this->options.buffer_size);
+    this->options.max_ready = std::max<size_t>(1, this->options.max_ready);
+
+#ifdef __linux__
+    if (this->options.io_uring) {
+        // NOTE: the ring is owned by the loader thread from here on
+        IoUring* ring = new IoUring();
+        if (uring_open(*ring, this->options.in_flight, this->options.buffer_size)) {
+            this->uring = true;
+            this->threads.emplace_back([this, ring]() {
+                this->read_with_io_uring(ring);
+                uring_close(*ring);
+                delete ring;
+            });
+            return;
+        }
+        delete ring;
+    }
+#endif
+
+    size_t thread_count = std::min(this->options.in_flight, std::max<size_t>(1, this->fnames.size()));
+    for (size_t i=0; i < thread_count; i++) {
+        this->threads.emplace_back(&FileLoader::read_with_pread, this);
+    }
+}
+
+/**
+ *  @brief FileLoader destructor. Stops reading and waits for the in flight reads.
+**/
+FileLoader::~FileLoader() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopped = true;
+    }
+    this->ready_changed.notify_all();
+
+    for (std::thread& thread : this->threads) {
+        thread.join();
+    }
+}
+
+/**
+ *  @brief Which backend reads the files.
+ *  @returns "io_uring" or "pread".
+**/
+const char* FileLoader::backend() const {
+    return this->uring ? "io_uring" : "pread";
+}
+
+/**
+ *  @brief Waits while max_ready files are waiting to be taken.
+ *  @returns false if the loader is stopping.
+**/
+bool FileLoader::wait_for_room() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->ready_changed.wait(lock, [this]() {
+        return this->stopped || this->ready.size() < this->options.max_ready;
+    });
+    return !this->stopped;
+}
+
+/**
+ *  @brief Whether fewer than max_ready files are waiting to be taken.
+**/
+bool FileLoader::has_room() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->ready.size() < this->options.max_ready;
+}
+
+/**
+ *  @brief Bytes a file of size bytes acquires from options.budget.
+**/
+size_t FileLoader::footprint(size_t size) const {
+    return this->options.footprint ? this->options.footprint(size) : size;
+}
+
+/**
+ *  @brief Hands a read (or failed) file to next().
+**/
+void FileLoader::finish(LoadedFile file) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->ready.push_back(std::move(file));
+    }
+    this->ready_changed.notify_all();
+}
+
+/**
+ *  @brief Waits for the next file that finished reading, or for the next
+ *  file in fnames order with options.in_order.
+ *  @param file replaced by that file, check file.error.
+ *  @returns false once every file was handed out.
+**/
+bool FileLoader::next(LoadedFile& file) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    if (this->handed_out == this->fnames.size()) {
+        return false;
+    }
+    size_t index = this->handed_out++;
+    auto found = this->ready.end();
+    this->ready_changed.wait(lock, [this, index, &found]() {
+        found = this->ready.begin();
+        if (this->options.in_order) {
+            found = std::find_if(this->ready.begin(), this->ready.end(), [index](const LoadedFile& file) {
+                return file.index == index;
+            });
+        }
+        return found != this->ready.end();
+    });
+
+    file = std::move(*found);
+    this->ready.erase(found);
+    lock.unlock();
+    // NOTE: wakes the reader waiting for room
+    this->ready_changed.notify_all();
+
+    return true;
+}
+
+/**
+ *  @brief Opens file index of fnames and acquires its footprint from
+ *  options.budget, waiting while it doesn't fit.
+ *  @param file replaced by the file, check file.error.
+ *  @param size gets the size of the file.
+ *  @returns The file descriptor, or -1.
+**/
+int FileLoader::admit_file(size_t index, LoadedFile& file, size_t& size) {
+    file = LoadedFile{index, this->fnames[index], "", ""};
+    size = 0;
+    int fd = open_for_reading(file.fname, size, file.error);
+
+    if (fd >= 0 && this->options.budget != nullptr) {
+        file.charged = this->footprint(size);
+        this->options.budget->acquire(file.charged);
+    }
+    return fd;
+}
+
+/**
+ *  @brief Reads an admitted file with pread and hands it to next().
+ *  @param fd from admit_file, closed here.
+**/
+void FileLoader::read_file(LoadedFile file, int fd, size_t size) {
+    if (fd >= 0) {
+        TraceSpan span("read", this->fnames[file.index]);
+        file.contents.resize(size);
+        size_t offset = 0;
+        while (offset < size) {
+            ssize_t count = pread(fd, &file.contents[offset], size - offset, offset);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count < 0) {
+                file.error = "could not read \"" + file.fname + "\": " + std::strerror(errno);
+                break;
+            }
+            if (count == 0) {
+                break;  // NOTE: the file got shorter
+            }
+            offset += count;
+        }
+        file.contents.resize(offset);
+        close(fd);
+    }
+
+    this->finish(std::move(file));
+}
+
+/**
+ *  @brief Fallback reader, one blocking file at a time per thread.
+**/
+void FileLoader::read_with_pread() {
+    trace_set_thread_name("loader");
+
+    while (this->wait_for_room()) {
+        LoadedFile file;
+        size_t size = 0;
+        int fd = -1;
+        {
+            // NOTE: files are admitted in fnames order like with io_uring, so
+            // a file waiting for the budget never waits on files after it.
+            // Callers that hold memory until earlier files are done (see
+            // MemoryBudget::force_acquire) rely on that to not deadlock.
+            std::lock_guard<std::mutex> lock(this->admit_mutex);
+            size_t index = this->next_file++;
+            if (index >= this->fnames.size()) {
+                return;
+            }
+            fd = this->admit_file(index, file, size);
+        }
+        this->read_file(std::move(file), fd, size);
+    }
+}
+
+/**
+ *  @brief io_uring reader, keeps a read in flight on every registered buffer.
+ *  A file is read in buffer_size chunks, one at a time, into its contents.
+**/
+void FileLoader::read_with_io_uring(IoUring* ring) {
+#ifdef __linux__
+    struct Slot {
+        bool busy = false;
+        bool waiting = false;  // NOTE: opened, waiting for options.budget
+        int fd = -1;
+        size_t size = 0;
+        LoadedFile file;
+        int track = -1;  // NOTE: trace track of the slot's reads, they overlap
+        int64_t read_start = 0;
+    };
+    std::vector<Slot> slots(this->options.in_flight);
+    trace_set_thread_name("loader");
+    if (trace_on) {
+        for (unsigned slot=0; slot < slots.size(); slot++) {
+            slots[slot].track = trace_add_track("loader read " + std::to_string(slot));
+        }
+    }
+    size_t busy = 0;
+    size_t waiting = 0;
+    unsigned queued = 0;
+    size_t buffer_size = ring->buffer_size;
+
+    auto queue_next_chunk = [&](unsigned slot) {
+        Slot& s = slots[slot];
+        size_t offset = s.file.contents.size();
+        uring_queue_read(*ring, slot, s.fd, std::min(buffer_size, s.size - offset), offset);
+        queued++;
+    };
+    auto start = [&](unsigned slot) {
+        Slot& s = slots[slot];
+        if (s.waiting) {
+            s.waiting = false;
+            waiting--;
+        }
+        s.file.contents.reserve(s.size);
+        s.read_start = trace_on ? trace_now_ns() : 0;
+        s.busy = true;
+        busy++;
+        queue_next_chunk(slot);
+    };
+    auto release = [&](unsigned slot) {
+        Slot& s = slots[slot];
+        close(s.fd);
+        if (s.track >= 0) {
+            trace_record_on(s.track, "read", s.file.fname, s.read_start, trace_now_ns());
+        }
+        s.busy = false;
+        busy--;
+        if (!this->stopped) {
+            this->finish(std::move(s.file));
+        }
+    };
+
+    while (true) {
+        // NOTE: start a file on every free buffer
+        for (unsigned slot=0; slot < slots.size() && !this->stopped; slot++) {
+            Slot& s = slots[slot];
+            if (s.waiting && this->options.budget->try_acquire(s.file.charged)) {
+                start(slot);
+            }
+
+            // NOTE: nothing new starts while a file waits for the budget, so it isn't starved by smaller ones
+            // NOTE: only waits for room with nothing in flight, with in_order
+            // next() may be waiting for a file that is still being read
+            while (
+                !s.busy && waiting == 0 && this->next_file < this->fnames.size() &&
+                (busy == 0 ? this->wait_for_room() : this->has_room())
+            ) {
+                size_t index = this->next_file++;
+                s.file = LoadedFile{index, this->fnames[index], "", ""};
+                s.fd = open_for_reading(s.file.fname, s.size, s.file.error);
+
+                if (s.fd < 0 || s.size == 0) {
+                    if (s.fd >= 0) {
+                        close(s.fd);
+                    }
+                    this->finish(std::move(s.file));
+                    continue;
+                }
+
+                if (this->options.budget != nullptr) {
+                    // NOTE: can't block here while other reads are in flight,
+                    // the slot waits and is retried after the next completion
+                    s.file.charged = this->footprint(s.size);
+                    if (!this->options.budget->try_acquire(s.file.charged)) {
+                        s.waiting = true;
+                        waiting++;
+                        break;
+                    }
+                }
+                start(slot);
+            }
+        }
+
+        if (busy == 0 && waiting > 0 && !this->stopped) {
+            // NOTE: nothing in flight to wait for, wait for the budget instead
+            for (unsigned slot=0; slot < slots.size(); slot++) {
+                if (slots[slot].waiting) {
+                    this->options.budget->acquire(slots[slot].file.charged);
+                    start(slot);
+                    break;
+                }
+            }
+        }
+
+        if (busy == 0) {
+            // NOTE: nothing in flight, every file is started or the loader stopped
+            for (Slot& s : slots) {
+                if (s.waiting) {
+                    close(s.fd);
+                }
+            }
+            return;
+        }
+
+        int entered = syscall(__NR_io_uring_enter, ring->fd, queued, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (entered < 0 && errno != EINTR) {
+            // NOTE: the ring is unusable, read the files it had started and
+            // every file after them with pread on this thread instead. The
+            // buffers are leaked on purpose, reads still in flight may land
+            // in them until the kernel tears the ring down.
+            for (std::unique_ptr<char[]>& buffer : ring->buffers) {
+                buffer.release();
+            }
+            for (Slot& s : slots) {
+                if (s.busy || s.waiting) {
+                    close(s.fd);
+                    if (s.busy && this->options.budget != nullptr) {
+                        this->options.budget->release(s.file.charged);
+                    }
+                    if (!this->stopped) {
+                        LoadedFile file;
+                        size_t size = 0;
+                        int fd = this->admit_file(s.file.index, file, size);
+                        this->read_file(std::move(file), fd, size);
+                    }
+                }
+            }
+            this->read_with_pread();
+            return;
+        }
+        if (entered >= 0) {
+            queued -= std::min<unsigned>(queued, entered);
+        }
+
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            io_uring_cqe* cqe = &ring->cqes[head & ring->cq_mask];
+            unsigned slot = cqe->user_data;
+            Slot& s = slots[slot];
+
+            if (cqe->res < 0) {
+                s.file.error = "could not read \"" + s.file.fname + "\": " + std::strerror(-cqe->res);
+                release(slot);
+                continue;
+            }
+
+            // NOTE: copied out so the buffer can take the next read right
+            // away, handing it to a worker would hold it until the file is
+            // tokenized. The copy is a memcpy, tokenizing the same bytes costs
+            // ~1000x more and split_lines copies them again anyway.
+            s.file.contents.append(ring->buffers[slot].get(), cqe->res);
+            // NOTE: 0 means the file got shorter
+            if (cqe->res == 0 || s.file.contents.size() >= s.size || this->stopped) {
+                release(slot);
+            }
+            else {
+                queue_next_chunk(slot);
+            }
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+#else
+    (void)ring;
+#endif
+}
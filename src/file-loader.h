@@ -0,0 +1,83 @@
+#ifndef FILE_LOADER_H
+#define FILE_LOADER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+#include "memory-budget.h"
+
+// NOTE: io_uring state, see file-loader.cpp
+struct IoUring;
+
+struct LoadedFile {
+    size_t index;          // NOTE: position in the fnames given to FileLoader
+    std::string fname;
+    std::string contents;  // NOTE: the whole file
+    std::string error;     // NOTE: empty if the file was read
+    size_t charged = 0;    // NOTE: bytes acquired from FileLoaderOptions::budget, release them once done with the file
+};
+
+struct FileLoaderOptions {
+    size_t in_flight = 16;             // NOTE: files being read at once
+    size_t buffer_size = 128 * 1024;   // NOTE: bytes per read, per registered buffer
+    size_t max_ready = 64;             // NOTE: read files waiting for next() before reading pauses
+    bool io_uring = true;              // NOTE: false always uses the pread threads
+    bool in_order = false;             // NOTE: next() hands files out in fnames order instead of as they finish
+    // NOTE: every file acquires footprint(size) (its size if footprint isn't set)
+    // from budget before it is read, in fnames order, reading waits while that doesn't fit
+    MemoryBudget* budget = nullptr;
+    std::function<size_t(size_t size)> footprint;
+};
+
+/**
+ *  @brief Reads a batch of files in the background and hands them out in the
+ *  order they finish, so tokenizing one file overlaps reading the next ones.
+ *
+ *  On Linux one thread drives an io_uring with in_flight reads into
+ *  registered buffers (IORING_OP_READ_FIXED). Where io_uring is missing or
+ *  not allowed (old kernel, seccomp, RLIMIT_MEMLOCK) in_flight threads read
+ *  with pread instead. next() can be called from any number of threads.
+**/
+class FileLoader {
+    private:
+        std::vector<std::string> fnames;
+        FileLoaderOptions options;
+        std::vector<std::thread> threads;
+        std::atomic<size_t> next_file;  // NOTE: next file to start reading
+        std::mutex admit_mutex;  // NOTE: held by a pread thread from taking next_file until it is admitted
+        std::atomic<bool> stopped;
+        bool uring;
+
+        std::mutex mutex;
+        std::condition_variable ready_changed;
+        std::deque<LoadedFile> ready;
+        size_t handed_out;
+
+        bool wait_for_room();
+        bool has_room();
+        size_t footprint(size_t size) const;
+        void finish(LoadedFile file);
+        int admit_file(size_t index, LoadedFile& file, size_t& size);
+        void read_file(LoadedFile file, int fd, size_t size);
+        void read_with_pread();
+        void read_with_io_uring(IoUring* ring);
+
+    public:
+        FileLoader(std::vector<std::string> fnames, const FileLoaderOptions& options = FileLoaderOptions());
+        ~FileLoader();
+
+        // not copyable, the reading threads hold on to this
+        FileLoader(const FileLoader&) = delete;
+        void operator=(const FileLoader&) = delete;
+
+        bool next(LoadedFile& file);
+        const char* backend() const;
+};
+
+#endif
@@ -0,0 +1,201 @@
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include "token.h"
+#include "interner.h"
+
+// NOTE: size of one arena chunk, chunks are never moved so the string_views
+// handed out by lookup() stay valid for the lifetime of the Interner
+static const size_t arena_chunk_size = 64 * 1024;
+static const size_t initial_slots = 1024;  // NOTE: must be a power of 2
+
+/**
+ *  @brief Interner constructor. Creates an empty table.
+**/
+Interner::Interner() : next_id(0) {
+    for (Shard& shard : this->shards) {
+        shard.slots.assign(initial_slots, Slot{0, NO_NAME_ID});
+    }
+    for (std::atomic<std::string_view*>& block : this->blocks) {
+        block.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+/**
+ *  @brief Interner destructor, frees the id blocks. The arenas free themselves.
+**/
+Interner::~Interner() {
+    for (std::atomic<std::string_view*>& block : this->blocks) {
+        delete[] block.load(std::memory_order_relaxed);
+    }
+}
+
+/**
+ *  @brief 32 bit FNV-1a hash.
+**/
+uint32_t Interner::hash(std::string_view s) {
+    uint32_t h = 2166136261u;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ *  @brief Finds where an id's view lives in this->blocks.
+ *  @param offset set to the index of the id in its block.
+ *  @returns The block, block b holds 1 << FIRST_BLOCK_BITS << b ids.
+**/
+size_t Interner::block_of(uint32_t id, size_t* offset) {
+    uint64_t biased = (uint64_t)id + (1 << FIRST_BLOCK_BITS);
+    int top_bit = 63 - __builtin_clzll(biased);
+    *offset = biased - ((uint64_t)1 << top_bit);
+    return top_bit - FIRST_BLOCK_BITS;
+}
+
+/**
+ *  @brief Copies s into a shard's arena, the shard has to be locked.
+ *  @returns A view of the copy.
+**/
+std::string_view Interner::store(Shard& shard, std::string_view s) {
+    if (shard.arena.empty() || shard.arena_used + s.size() > shard.arena_capacity) {
+        size_t chunk_size = std::max(arena_chunk_size, s.size());
+        shard.arena.push_back(std::make_unique<char[]>(chunk_size));
+        shard.arena_used = 0;
+        shard.arena_capacity = chunk_size;
+    }
+
+    char* dest = shard.arena.back().get() + shard.arena_used;
+    std::memcpy(dest, s.data(), s.size());
+    shard.arena_used += s.size();
+    shard.bytes += s.size();
+
+    return std::string_view(dest, s.size());
+}
+
+/**
+ *  @brief Doubles a shard's slots and reinserts every id, the shard has to
+ *  be locked.
+**/
+void Interner::grow(Shard& shard) {
+    std::vector<Slot> old_slots;
+    old_slots.swap(shard.slots);
+    shard.slots.assign(old_slots.size() * 2, Slot{0, NO_NAME_ID});
+
+    size_t mask = shard.slots.size() - 1;
+    for (const Slot& slot : old_slots) {
+        if (slot.id == NO_NAME_ID) {
+            continue;
+        }
+        size_t i = slot.hash & mask;
+        while (shard.slots[i].id != NO_NAME_ID) {
+            i = (i + 1) & mask;
+        }
+        shard.slots[i] = slot;
+    }
+}
+
+/**
+ *  @brief Looks up s, adding it if it hasn't been seen yet. Only the shard
+ *  of s is locked.
+ *  @param s string to intern.
+ *  @param stored if not null, set to the copy of s in the arena, like lookup().
+ *  @returns The id of s.
+**/
+uint32_t Interner::intern(std::string_view s, std::string_view* stored) {
+    uint32_t h = hash(s);
+    // NOTE: the top bits pick the shard, the low bits the slot in it
+    Shard& shard = this->shards[h >> (32 - SHARD_BITS)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    size_t mask = shard.slots.size() - 1;
+    size_t i = h & mask;
+
+    // NOTE: linear probing, the stored hash skips most string compares
+    while (shard.slots[i].id != NO_NAME_ID) {
+        const Slot& slot = shard.slots[i];
+        if (slot.hash == h) {
+            size_t offset;
+            std::string_view existing = this->blocks[block_of(slot.id, &offset)].load(std::memory_order_relaxed)[offset];
+            if (existing == s) {
+                if (stored != nullptr) {
+                    *stored = existing;
+                }
+                return slot.id;
+            }
+        }
+        i = (i + 1) & mask;
+    }
+
+    uint64_t next = this->next_id.fetch_add(1);
+    if (next >= NO_NAME_ID) {
+        throw std::runtime_error("Interner is full");
+    }
+    uint32_t id = next;
+
+    size_t offset;
+    std::atomic<std::string_view*>& block = this->blocks[block_of(id, &offset)];
+    std::string_view* views = block.load(std::memory_order_acquire);
+    if (views == nullptr) {
+        std::lock_guard<std::mutex> blocks_lock(this->blocks_mutex);
+        views = block.load(std::memory_order_acquire);
+        if (views == nullptr) {
+            views = new std::string_view[(size_t)1 << FIRST_BLOCK_BITS << (&block - this->blocks.data())];
+            block.store(views, std::memory_order_release);
+        }
+    }
+    views[offset] = store(shard, s);
+    shard.slots[i] = Slot{h, id};
+    shard.count++;
+    if (stored != nullptr) {
+        *stored = views[offset];
+    }
+
+    // NOTE: keep the load factor under 1/2 so probe sequences stay short
+    if (shard.count * 2 > shard.slots.size()) {
+        grow(shard);
+    }
+
+    return id;
+}
+
+/**
+ *  @brief Fetches the string for an id, without taking a lock. An id is
+ *  known once intern() returned it.
+ *  @param id id returned by intern().
+ *  @returns The interned string, valid as long as this Interner.
+**/
+std::string_view Interner::lookup(uint32_t id) const {
+    std::string_view* views = nullptr;
+    size_t offset = 0;
+    if (id < this->next_id.load(std::memory_order_acquire)) {
+        views = this->blocks[block_of(id, &offset)].load(std::memory_order_acquire);
+    }
+    if (views == nullptr) {
+        throw std::runtime_error("Interner::lookup() unknown id " + std::to_string(id));
+    }
+    return views[offset];
+}
+
+/**
+ *  @brief Number of distinct strings interned.
+**/
+size_t Interner::size() const {
+    return std::min<uint64_t>(this->next_id.load(), NO_NAME_ID);
+}
+
+/**
+ *  @brief Bytes of string data held in the arenas.
+**/
+size_t Interner::arena_bytes() const {
+    size_t bytes = 0;
+    for (const Shard& shard : this->shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        bytes += shard.bytes;
+    }
+    return bytes;
+}
@@ -0,0 +1,74 @@
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+/**
+ *  @brief Assigns every distinct string a dense uint32 id, 0, 1, 2, ...
+ *  Strings are copied once into an arena and found again through an open
+ *  addressing table, so equal NAME Tokens compare by id. One Interner can be
+ *  shared by several Tokenizers (and threads) to get ids that are stable
+ *  across a whole batch of files.
+ *
+ *  The table is split into SHARD_COUNT shards by hash, each with its own
+ *  lock, table and arena, so threads interning different names rarely wait
+ *  on each other. Ids still come from one counter. The id -> string table
+ *  is a list of blocks that double in size and never move, so lookup()
+ *  takes no lock.
+**/
+class Interner {
+    private:
+        struct Slot {
+            uint32_t hash;
+            uint32_t id;  // NOTE: NO_NAME_ID marks an empty slot
+        };
+
+        // NOTE: on its own cache line, so shards don't share one between threads
+        struct alignas(64) Shard {
+            mutable std::mutex mutex;
+            std::vector<Slot> slots;
+            size_t count = 0;
+            std::vector<std::unique_ptr<char[]>> arena;
+            size_t arena_used = 0;
+            size_t arena_capacity = 0;
+            size_t bytes = 0;
+        };
+
+        static const int SHARD_BITS = 4;
+        static const size_t SHARD_COUNT = 1 << SHARD_BITS;
+        static const int FIRST_BLOCK_BITS = 10;
+        static const size_t BLOCK_COUNT = 33 - FIRST_BLOCK_BITS;  // NOTE: enough for every uint32 id
+
+        std::array<Shard, SHARD_COUNT> shards;
+        std::atomic<uint64_t> next_id;
+        // NOTE: block b holds the views of ids (1 << FIRST_BLOCK_BITS << b) - (1 << FIRST_BLOCK_BITS) on
+        std::array<std::atomic<std::string_view*>, BLOCK_COUNT> blocks;
+        std::mutex blocks_mutex;  // NOTE: only taken to allocate a block
+
+        static uint32_t hash(std::string_view s);
+        static std::string_view store(Shard& shard, std::string_view s);
+        static void grow(Shard& shard);
+        static size_t block_of(uint32_t id, size_t* offset);
+
+    public:
+        Interner();
+        ~Interner();
+
+        // not copyable, ids point into the shards' arenas
+        Interner(const Interner&) = delete;
+        void operator=(const Interner&) = delete;
+
+        uint32_t intern(std::string_view s, std::string_view* stored = nullptr);
+        std::string_view lookup(uint32_t id) const;
+        size_t size() const;
+        size_t arena_bytes() const;
+};
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#include <string_view>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ *  @brief Python keywords and soft keywords (keyword.kwlist and
+ *  keyword.softkwlist, plus "type" from 3.12). The tokenizer still reports
+ *  them as NAME Tokens, Token::keyword tells them apart with one integer
+ *  compare instead of string compares.
+**/
+enum class Keyword : uint8_t {
+    NOT_A_KEYWORD,
+    FALSE,
+    NONE,
+    TRUE,
+    AND,
+    AS,
+    ASSERT,
+    ASYNC,
+    AWAIT,
+    BREAK,
+    CLASS,
+    CONTINUE,
+    DEF,
+    DEL,
+    ELIF,
+    ELSE,
+    EXCEPT,
+    FINALLY,
+    FOR,
+    FROM,
+    GLOBAL,
+    IF,
+    IMPORT,
+    IN,
+    IS,
+    LAMBDA,
+    NONLOCAL,
+    NOT,
+    OR,
+    PASS,
+    RAISE,
+    RETURN,
+    TRY,
+    WHILE,
+    WITH,
+    YIELD,
+    // NOTE: soft keywords from here on, only keywords in some contexts
+    MATCH,
+    CASE,
+    TYPE,
+    UNDERSCORE
+};
+
+const int KEYWORD_COUNT = (int)Keyword::UNDERSCORE + 1;
+
+// NOTE: indexed by Keyword, "" for NOT_A_KEYWORD
+constexpr std::array<std::string_view, KEYWORD_COUNT> keyword_names = {
+    "",
+    "False", "None", "True", "and", "as", "assert", "async", "await",
+    "break", "class", "continue", "def", "del", "elif", "else", "except",
+    "finally", "for", "from", "global", "if", "import", "in", "is",
+    "lambda", "nonlocal", "not", "or", "pass", "raise", "return", "try",
+    "while", "with", "yield",
+    "match", "case", "type", "_"
+};
+
+constexpr bool is_soft_keyword(Keyword keyword) {
+    return keyword >= Keyword::MATCH;
+}
+
+constexpr std::string_view keyword_name(Keyword keyword) {
+    return keyword_names[(int)keyword];
+}
+
+// NOTE: perfect hash on (length, first character, last character), which
+// is unique per keyword. The multiplier is searched at compile time until
+// every keyword lands in its own slot of a KEYWORD_SLOTS table, so a lookup
+// is one multiply, one table load and one string compare.
+
+const size_t KEYWORD_SLOTS = 256;
+const size_t KEYWORD_MAX_LENGTH = 8;  // NOTE: "continue", "nonlocal"
+
+constexpr uint32_t keyword_slot(std::string_view word, uint32_t multiplier) {
+    uint32_t key = (uint32_t)word.size()
+        | (uint32_t)(unsigned char)word.front() << 8
+        | (uint32_t)(unsigned char)word.back() << 16;
+    return (key * multiplier) >> 24;  // NOTE: top 8 bits, KEYWORD_SLOTS == 256
+}
+
+constexpr bool keyword_slots_collide(uint32_t multiplier) {
+    std::array<bool, KEYWORD_SLOTS> used{};
+    for (int i=1; i < KEYWORD_COUNT; i++) {
+        uint32_t slot = keyword_slot(keyword_names[i], multiplier);
+        if (used[slot]) {
+            return true;
+        }
+        used[slot] = true;
+    }
+    return false;
+}
+
+constexpr uint32_t find_keyword_multiplier() {
+    uint32_t multiplier = 0x9E3779B1u;  // NOTE: any odd start works, this one is 2^32 / phi
+    while (keyword_slots_collide(multiplier)) {
+        multiplier += 2;
+    }
+    return multiplier;
+}
+
+constexpr uint32_t KEYWORD_MULTIPLIER = find_keyword_multiplier();
+
+constexpr std::array<Keyword, KEYWORD_SLOTS> build_keyword_table() {
+    std::array<Keyword, KEYWORD_SLOTS> table{};
+    for (int i=1; i < KEYWORD_COUNT; i++) {
+        table[keyword_slot(keyword_names[i], KEYWORD_MULTIPLIER)] = (Keyword)i;
+    }
+    return table;
+}
+
+constexpr std::array<Keyword, KEYWORD_SLOTS> keyword_table = build_keyword_table();
+
+/**
+ *  @brief Classifies a NAME.
+ *  @returns The Keyword word spells, or Keyword::NOT_A_KEYWORD.
+**/
+constexpr Keyword classify_keyword(std::string_view word) {
+    if (word.empty() || word.size() > KEYWORD_MAX_LENGTH) {
+        return Keyword::NOT_A_KEYWORD;
+    }
+    Keyword keyword = keyword_table[keyword_slot(word, KEYWORD_MULTIPLIER)];
+    return keyword_names[(int)keyword] == word ? keyword : Keyword::NOT_A_KEYWORD;
+}
+
+static_assert(classify_keyword("lambda") == Keyword::LAMBDA, "keyword table is broken");
+static_assert(classify_keyword("_") == Keyword::UNDERSCORE, "keyword table is broken");
+static_assert(classify_keyword("lambdas") == Keyword::NOT_A_KEYWORD, "keyword table is broken");
+
+#endif
@@ -0,0 +1,76 @@
+#include <string>
+#include <string_view>
+#include <mutex>
+#include <cstdint>
+#include "line-cache.h"
+
+/**
+ *  @brief Fraction of lookups that were hits.
+**/
+double LineCacheStats::hit_rate() const {
+    return this->lookups > 0 ? (double)this->hits / this->lookups : 0.0;
+}
+
+/**
+ *  @brief LineCache constructor.
+ *  @param max_lines stop adding lines after this many.
+**/
+LineCache::LineCache(size_t max_lines) {
+    this->max_lines = max_lines;
+}
+
+/**
+ *  @brief 64 bit FNV-1a hash of the indentation and content.
+**/
+uint64_t LineCache::hash(int indent, std::string_view content) {
+    uint64_t h = 14695981039346656037ULL;
+    h = (h ^ (uint64_t)indent) * 1099511628211ULL;
+    for (unsigned char c : content) {
+        h = (h ^ c) * 1099511628211ULL;
+    }
+    return h;
+}
+
+/**
+ *  @brief Looks up a line.
+ *  @param indent column of the line's first Token.
+ *  @param content the line without its indentation.
+ *  @returns The cached line, valid as long as this LineCache, or nullptr on a miss.
+**/
+const CachedLine* LineCache::find(int indent, std::string_view content) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->counters.lookups++;
+
+    auto it = this->lines.find(hash(indent, content));
+    // NOTE: a hash collision with a different line counts as a miss
+    if (it == this->lines.end() || it->second.indent != indent || it->second.content != content) {
+        return nullptr;
+    }
+
+    this->counters.hits++;
+    return &it->second;
+}
+
+/**
+ *  @brief Adds a line, unless the cache is full or the line is already in it.
+ *  @param line the line's Tokens.
+**/
+void LineCache::insert(CachedLine line) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    if (this->lines.size() >= this->max_lines) {
+        return;
+    }
+    uint64_t key = hash(line.indent, line.content);
+    if (this->lines.emplace(key, std::move(line)).second) {
+        this->counters.lines++;
+    }
+}
+
+/**
+ *  @brief Hit/miss counters since construction.
+**/
+LineCacheStats LineCache::stats() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->counters;
+}
@@ -0,0 +1,65 @@
+#ifndef LINE_CACHE_H
+#define LINE_CACHE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include "token.h"
+
+struct CachedToken {
+    TokenKind kind;
+    std::string value;
+    int column_start, column_end;
+    NumberValue number;  // NOTE: NUMBER Tokens only, replayed with the Token
+};
+
+/**
+ *  @brief The Tokens of one line, from its first Token up to its NEWLINE.
+ *  INDENT/DEDENT aren't included, they depend on the lines before.
+**/
+struct CachedLine {
+    int indent;
+    std::string content;  // NOTE: the line without its indentation
+    std::vector<CachedToken> tokens;
+};
+
+struct LineCacheStats {
+    size_t lookups = 0;
+    size_t hits = 0;
+    size_t lines = 0;
+
+    double hit_rate() const;
+};
+
+/**
+ *  @brief Remembers the Tokens of lines that start and end outside of any
+ *  bracket or string, keyed by indentation and content, so repeated lines
+ *  (imports, decorators, boilerplate) are replayed instead of re-matched.
+ *  Can be shared by several Tokenizers (and threads), lines are never evicted,
+ *  once max_lines is reached new lines just aren't added.
+**/
+class LineCache {
+    private:
+        std::unordered_map<uint64_t, CachedLine> lines;
+        size_t max_lines;
+        LineCacheStats counters;
+        mutable std::mutex mutex;
+
+        static uint64_t hash(int indent, std::string_view content);
+
+    public:
+        explicit LineCache(size_t max_lines = 1 << 16);
+
+        // not copyable, Tokenizers hold on to the CachedLines
+        LineCache(const LineCache&) = delete;
+        void operator=(const LineCache&) = delete;
+
+        const CachedLine* find(int indent, std::string_view content);
+        void insert(CachedLine line);
+        LineCacheStats stats() const;
+};
+
+#endif
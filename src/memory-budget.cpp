@@ -0,0 +1,78 @@
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstddef>
+#include "memory-budget.h"
+
+/**
+ *  @brief MemoryBudget constructor.
+ *  @param limit bytes that can be acquired at once.
+**/
+MemoryBudget::MemoryBudget(size_t limit) : limit(limit), used(0), peak(0) {}
+
+/**
+ *  @brief Whether bytes can be acquired now, this->mutex must be held.
+**/
+bool MemoryBudget::fits(size_t bytes) const {
+    return this->used == 0 || this->used + bytes <= this->limit;
+}
+
+/**
+ *  @brief Acquires bytes, waiting for releases while they don't fit.
+**/
+void MemoryBudget::acquire(size_t bytes) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->released.wait(lock, [this, bytes]() {
+        return this->fits(bytes);
+    });
+    this->used += bytes;
+    this->peak = std::max(this->peak, this->used);
+}
+
+/**
+ *  @brief Acquires bytes if they fit right now.
+ *  @returns false if they don't, nothing is acquired then.
+**/
+bool MemoryBudget::try_acquire(size_t bytes) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (!this->fits(bytes)) {
+        return false;
+    }
+    this->used += bytes;
+    this->peak = std::max(this->peak, this->used);
+    return true;
+}
+
+/**
+ *  @brief Acquires bytes without waiting, even past the limit. For memory
+ *  that is already in use (e.g. buffered output), acquire and try_acquire
+ *  wait for it to be released like for any other work.
+**/
+void MemoryBudget::force_acquire(size_t bytes) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->used += bytes;
+    this->peak = std::max(this->peak, this->used);
+}
+
+/**
+ *  @brief Gives back bytes from an earlier acquire.
+**/
+void MemoryBudget::release(size_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->used -= std::min(bytes, this->used);
+    }
+    this->released.notify_all();
+}
+
+size_t MemoryBudget::get_limit() const {
+    return this->limit;
+}
+
+/**
+ *  @brief Most bytes acquired at once, the estimated peak.
+**/
+size_t MemoryBudget::get_peak() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->peak;
+}
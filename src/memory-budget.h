@@ -0,0 +1,41 @@
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+/**
+ *  @brief Admission control against a byte budget. Work acquires its
+ *  estimated footprint before it starts and releases it when done, acquire
+ *  waits while that would go over the limit. Work is always admitted when
+ *  nothing else is, so a single item bigger than the whole budget still runs
+ *  (alone) instead of waiting forever.
+**/
+class MemoryBudget {
+    private:
+        size_t limit;
+        size_t used;
+        size_t peak;
+        mutable std::mutex mutex;
+        std::condition_variable released;
+
+        bool fits(size_t bytes) const;
+
+    public:
+        explicit MemoryBudget(size_t limit);
+
+        // not copyable, threads wait on it
+        MemoryBudget(const MemoryBudget&) = delete;
+        void operator=(const MemoryBudget&) = delete;
+
+        void acquire(size_t bytes);
+        bool try_acquire(size_t bytes);
+        void force_acquire(size_t bytes);
+        void release(size_t bytes);
+
+        size_t get_limit() const;
+        size_t get_peak() const;
+};
+
+#endif
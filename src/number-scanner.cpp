@@ -0,0 +1,188 @@
+#include <string>
+#include <charconv>
+#include <system_error>
+#include <cstdlib>
+#include <cstddef>
+#include "token.h"
+#include "number-scanner.h"
+
+// NOTE: numeric literal grammar
+// https://docs.python.org/3/reference/lexical_analysis.html#numeric-literals
+// matched the way the Number regex of python's tokenize module does, which
+// tries imaginary, then float, then int and takes the first that matches.
+// So "0777" is NUMBER "0" then NUMBER "777" and "1_" is NUMBER "1" then
+// NAME "_", like python -m tokenize.
+
+static bool is_decimal_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool is_hex_digit(char c) {
+    return is_decimal_digit(c) || ((c | 0x20) >= 'a' && (c | 0x20) <= 'f');
+}
+
+static bool is_octal_digit(char c) {
+    return c >= '0' && c <= '7';
+}
+
+static bool is_binary_digit(char c) {
+    return c == '0' || c == '1';
+}
+
+/**
+ *  @brief Matches digit (["_"] digit)* at line[pos].
+ *  @returns The end of the match, pos if there is no digit at pos.
+**/
+static size_t scan_digits(const std::string& line, size_t pos, bool (*is_digit)(char)) {
+    if (pos >= line.size() || !is_digit(line[pos])) {
+        return pos;
+    }
+
+    size_t end = pos + 1;
+    while (true) {
+        if (end < line.size() && is_digit(line[end])) {
+            end++;
+        }
+        else if (end + 1 < line.size() && line[end] == '_' && is_digit(line[end+1])) {
+            end += 2;
+        }
+        else {
+            return end;
+        }
+    }
+}
+
+/**
+ *  @brief Matches ("e" | "E") ["+" | "-"] digitpart at line[pos].
+ *  @returns The end of the match, pos if there is no exponent at pos.
+**/
+static size_t scan_exponent(const std::string& line, size_t pos) {
+    if (pos >= line.size() || (line[pos] | 0x20) != 'e') {
+        return pos;
+    }
+
+    size_t digits = pos + 1;
+    if (digits < line.size() && (line[digits] == '+' || line[digits] == '-')) {
+        digits++;
+    }
+    size_t end = scan_digits(line, digits, is_decimal_digit);
+    return end > digits ? end : pos;
+}
+
+/**
+ *  @brief Decodes line[begin, end) without its '_'s into value, base is
+ *  ignored for FLOAT and IMAGINARY.
+**/
+static void decode_number(const std::string& line, size_t begin, size_t end, int base, NumberValue& value) {
+    // NOTE: literals are short, only ones longer than the buffer allocate
+    char buffer[64];
+    std::string long_digits;
+    char* digits = buffer;
+    if (end - begin >= sizeof(buffer)) {
+        long_digits.resize(end - begin + 1);
+        digits = &long_digits[0];
+    }
+
+    size_t size = 0;
+    for (size_t i=begin; i < end; i++) {
+        if (line[i] != '_') {
+            digits[size++] = line[i];
+        }
+    }
+    digits[size] = '\0';
+
+    if (value.kind == NumberKind::INT) {
+        std::from_chars_result result = std::from_chars(digits, digits + size, value.integer, base);
+        if (result.ec == std::errc::result_out_of_range) {
+            value.overflow = true;
+            value.integer = 0;
+        }
+        return;
+    }
+
+    std::from_chars_result result = std::from_chars(digits, digits + size, value.real);
+    if (result.ec == std::errc::result_out_of_range) {
+        // NOTE: strtod rounds to inf or 0 like python does, from_chars leaves value alone
+        value.real = std::strtod(digits, nullptr);
+    }
+}
+
+/**
+ *  @brief Scans the NUMBER at line[pos] and decodes its value in the same pass.
+ *  A leading "-" is never part of a NUMBER, it is an OP.
+ *  @param line line to scan.
+ *  @param pos position to start at.
+ *  @returns The length of the match (0 if there is no NUMBER at pos) and its value.
+**/
+NumberMatch scan_number(const std::string& line, size_t pos) {
+    NumberMatch match{0, NumberValue()};
+
+    // NOTE: 0x, 0o, 0b, a "_" may follow the prefix
+    if (pos + 1 < line.size() && line[pos] == '0') {
+        char prefix = line[pos+1] | 0x20;
+        int base = prefix == 'x' ? 16 : prefix == 'o' ? 8 : prefix == 'b' ? 2 : 0;
+        if (base != 0) {
+            bool (*is_digit)(char) = base == 16 ? is_hex_digit : base == 8 ? is_octal_digit : is_binary_digit;
+            size_t digits = pos + 2;
+            if (digits < line.size() && line[digits] == '_') {
+                digits++;
+            }
+            size_t end = scan_digits(line, digits, is_digit);
+            if (end > digits) {
+                match.length = end - pos;
+                match.value.kind = NumberKind::INT;
+                decode_number(line, pos + 2, end, base, match.value);
+                return match;
+            }
+            // NOTE: "0x" without digits is NUMBER "0", then a NAME
+        }
+    }
+
+    size_t integer_end = scan_digits(line, pos, is_decimal_digit);
+    size_t end = integer_end;
+    NumberKind kind = NumberKind::INT;
+
+    if (end < line.size() && line[end] == '.') {
+        size_t fraction_end = scan_digits(line, end + 1, is_decimal_digit);
+        if (integer_end == pos && fraction_end == end + 1) {
+            return match;  // NOTE: a "." on its own is an OP
+        }
+        end = scan_exponent(line, fraction_end);
+        kind = NumberKind::FLOAT;
+    }
+    else if (integer_end == pos) {
+        return match;
+    }
+    else if (scan_exponent(line, end) > end) {
+        end = scan_exponent(line, end);
+        kind = NumberKind::FLOAT;
+    }
+
+    if (end < line.size() && (line[end] | 0x20) == 'j') {
+        match.length = end + 1 - pos;
+        match.value.kind = NumberKind::IMAGINARY;
+        decode_number(line, pos, end, 10, match.value);
+        return match;
+    }
+
+    if (kind == NumberKind::INT && line[pos] == '0') {
+        // NOTE: no leading zeros, "0" ("_"? "0")* only
+        end = pos + 1;
+        while (true) {
+            if (end < line.size() && line[end] == '0') {
+                end++;
+            }
+            else if (end + 1 < line.size() && line[end] == '_' && line[end+1] == '0') {
+                end += 2;
+            }
+            else {
+                break;
+            }
+        }
+    }
+
+    match.length = end - pos;
+    match.value.kind = kind;
+    decode_number(line, pos, end, 10, match.value);
+    return match;
+}
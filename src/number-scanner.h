@@ -0,0 +1,15 @@
+#ifndef NUMBER_SCANNER_H
+#define NUMBER_SCANNER_H
+
+#include <string>
+#include <cstddef>
+#include "token.h"
+
+struct NumberMatch {
+    size_t length;      // NOTE: bytes matched, 0 if there is no NUMBER at pos
+    NumberValue value;
+};
+
+NumberMatch scan_number(const std::string& line, size_t pos);
+
+#endif
@@ -0,0 +1,162 @@
+#include <string>
+#include <vector>
+#include <new>
+#include <utility>
+#include <chrono>
+#include <stdexcept>
+#include <cstddef>
+#include "token.h"
+#include "span-sink.h"
+#include "regex-tokenizer.h"
+#include "regex-tokenizer-c.h"
+
+// NOTE: the C ABI only ever hands out pointers to rtok_result and
+// rtok_token, no C++ type or exception crosses it
+
+static_assert(sizeof(rtok_token) == 24, "rtok_token is part of the ABI");
+static_assert(RTOK_UNKNOWN == (int)TokenKind::UNKNOWN, "rtok_kind has to match TokenKind");
+
+struct rtok_result {
+    std::vector<rtok_token> tokens;
+    size_t next = 0;
+    int status = RTOK_OK;
+    std::string error;
+};
+
+/**
+ *  @brief Splits buffer into lines like read_lines, without the '\n's.
+ *  @param line_offsets gets the offset of every line, then size.
+**/
+static std::vector<std::string> split_lines(
+    const char* buffer,
+    size_t size,
+    std::vector<size_t>& line_offsets
+) {
+    std::vector<std::string> lines;
+    size_t line_start = 0;
+
+    for (size_t i=0; i < size; i++) {
+        if (buffer[i] == '\n') {
+            line_offsets.push_back(line_start);
+            lines.emplace_back(buffer + line_start, i - line_start);
+            line_start = i + 1;
+        }
+    }
+    if (line_start < size) {
+        // NOTE: last line without a '\n'
+        line_offsets.push_back(line_start);
+        lines.emplace_back(buffer + line_start, size - line_start);
+    }
+    line_offsets.push_back(size);
+
+    return lines;
+}
+
+/**
+ *  @brief Tokenizes size bytes of buffer, see rtok_tokenize.
+**/
+static rtok_result* tokenize_buffer(const char* buffer, size_t size, const TokenizerOptions& options) {
+    rtok_result* result = new (std::nothrow) rtok_result();
+    if (result == nullptr) {
+        return nullptr;
+    }
+
+    try {
+        std::vector<size_t> line_offsets;
+        std::vector<std::string> lines = split_lines(buffer, size, line_offsets);
+
+        // NOTE: SpanSink writes straight into result->tokens, so the Tokens
+        // before an error are kept when the constructor throws. It maps
+        // columns through buffer, the tokenizer owns the only copy of the lines
+        BasicTokenizer<SpanSink> tokenizer(std::move(lines), SpanSink(buffer, &line_offsets, &result->tokens), options);
+        if (tokenizer.get_status() == TokenizeStatus::DEADLINE) {
+            result->status = RTOK_DEADLINE;
+        }
+    }
+    catch (const std::bad_alloc&) {
+        delete result;
+        return nullptr;
+    }
+    catch (const std::exception& e) {
+        result->status = RTOK_ERROR;
+        result->error = e.what();
+    }
+
+    return result;
+}
+
+extern "C" {
+
+int rtok_abi_version(void) {
+    return RTOK_ABI_VERSION;
+}
+
+/**
+ *  @brief Tokenizes size bytes of buffer.
+ *  @returns The result to pass to the other rtok_ functions and free with
+ *  rtok_free, or NULL if out of memory.
+**/
+rtok_result* rtok_tokenize(const char* buffer, size_t size) {
+    return tokenize_buffer(buffer, size, TokenizerOptions());
+}
+
+/**
+ *  @brief rtok_tokenize with a deadline timeout_ns from now. A timeout past
+ *  the end of the clock (e.g. UINT64_MAX) means no deadline.
+**/
+rtok_result* rtok_tokenize_with_timeout(const char* buffer, size_t size, uint64_t timeout_ns) {
+    TokenizerOptions options;
+    auto now = std::chrono::steady_clock::now();
+    // NOTE: adding more than is left until time_point::max() would overflow
+    auto left = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::time_point::max() - now);
+    if (timeout_ns < (uint64_t)left.count()) {
+        options.deadline = now + std::chrono::nanoseconds(timeout_ns);
+    }
+    return tokenize_buffer(buffer, size, options);
+}
+
+int rtok_status(const rtok_result* result) {
+    return result->status;
+}
+
+/**
+ *  @returns The error message if rtok_status is RTOK_ERROR, else "".
+**/
+const char* rtok_error(const rtok_result* result) {
+    return result->error.c_str();
+}
+
+const rtok_token* rtok_tokens(const rtok_result* result) {
+    return result->tokens.data();
+}
+
+size_t rtok_token_count(const rtok_result* result) {
+    return result->tokens.size();
+}
+
+const rtok_token* rtok_next(rtok_result* result) {
+    if (result->next < result->tokens.size()) {
+        return &result->tokens[result->next++];
+    }
+    return nullptr;
+}
+
+void rtok_rewind(rtok_result* result) {
+    result->next = 0;
+}
+
+void rtok_free(rtok_result* result) {
+    delete result;
+}
+
+/**
+ *  @returns The python name of kind, e.g. "NAME", valid forever.
+**/
+const char* rtok_kind_name(uint32_t kind) {
+    if (kind > RTOK_UNKNOWN) {
+        kind = RTOK_UNKNOWN;
+    }
+    return token_kind_name((TokenKind)kind).c_str();
+}
+
+}
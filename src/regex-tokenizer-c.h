@@ -0,0 +1,93 @@
+#ifndef REGEX_TOKENIZER_C_H
+#define REGEX_TOKENIZER_C_H
+
+/*
+ *  C ABI of libregextokenizer.so (make libregextokenizer.so), for using the
+ *  tokenizer in-process from C, Python (ctypes), Rust, Go, ...
+ *
+ *      rtok_result* result = rtok_tokenize(buffer, size);
+ *      const rtok_token* token;
+ *      while ((token = rtok_next(result)) != NULL) {
+ *          // buffer + token->offset, token->length bytes
+ *      }
+ *      rtok_free(result);
+ *
+ *  Tokens don't own any text, offset/length point into the buffer that was
+ *  tokenized, which has to outlive any use of them. Everything here only
+ *  ever gets added to, bump RTOK_ABI_VERSION if that changes.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RTOK_ABI_VERSION 1
+
+#if defined(__GNUC__)
+#define RTOK_API __attribute__((visibility("default")))
+#else
+#define RTOK_API
+#endif
+
+/* NOTE: same values as TokenKind in token.h */
+enum rtok_kind {
+    RTOK_ENCODING = 0,
+    RTOK_NAME = 1,
+    RTOK_NUMBER = 2,
+    RTOK_STRING = 3,
+    RTOK_OP = 4,
+    RTOK_COMMENT = 5,
+    RTOK_NL = 6,
+    RTOK_NEWLINE = 7,
+    RTOK_INDENT = 8,
+    RTOK_DEDENT = 9,
+    RTOK_ENDMARKER = 10,
+    RTOK_UNKNOWN = 11
+};
+
+enum rtok_status {
+    RTOK_OK = 0,
+    RTOK_ERROR = 1,     /* NOTE: invalid input, the tokens before the error are kept */
+    RTOK_DEADLINE = 2   /* NOTE: timed out, the tokens before that are kept */
+};
+
+/* NOTE: 24 bytes, no padding */
+typedef struct rtok_token {
+    uint32_t kind;      /* NOTE: an rtok_kind */
+    uint32_t line;      /* NOTE: 1 based like python, 0 for ENCODING */
+    uint32_t col;       /* NOTE: in code points like python */
+    uint32_t length;    /* NOTE: in bytes, multiline STRINGs include their newlines */
+    uint64_t offset;    /* NOTE: in bytes from the start of the buffer */
+} rtok_token;
+
+typedef struct rtok_result rtok_result;
+
+RTOK_API int rtok_abi_version(void);
+
+/* NOTE: NULL only if out of memory, check rtok_status for invalid input */
+RTOK_API rtok_result* rtok_tokenize(const char* buffer, size_t size);
+/* NOTE: stops with RTOK_DEADLINE after about timeout_ns nanoseconds, UINT64_MAX for no deadline */
+RTOK_API rtok_result* rtok_tokenize_with_timeout(const char* buffer, size_t size, uint64_t timeout_ns);
+RTOK_API int rtok_status(const rtok_result* result);
+RTOK_API const char* rtok_error(const rtok_result* result);
+
+/* NOTE: the whole flat array, valid until rtok_free */
+RTOK_API const rtok_token* rtok_tokens(const rtok_result* result);
+RTOK_API size_t rtok_token_count(const rtok_result* result);
+
+/* NOTE: iteration, NULL after the last token, rtok_rewind starts over */
+RTOK_API const rtok_token* rtok_next(rtok_result* result);
+RTOK_API void rtok_rewind(rtok_result* result);
+
+RTOK_API void rtok_free(rtok_result* result);
+
+RTOK_API const char* rtok_kind_name(uint32_t kind);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
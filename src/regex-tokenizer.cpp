@@ -1,14 +1,21 @@
 #include <iostream>
 #include <vector>
-#include <regex>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <numeric>
+#include <algorithm>
 #include <cassert>
+#include <cctype>
 #include "logging.h"
 #include "util.h"
 #include "token.h"
+#include "unicode.h"
+#include "string-scanner.h"
+#include "number-scanner.h"
 #include "regex-tokenizer.h"
+#include "span-sink.h"
+#include "token-pipeline.h"
 
 // NOTE: source on how python handles indentation
 // https://docs.python.org/2.0/ref/indentation.html
@@ -36,7 +43,7 @@
 
 // NOTE: _sub and sub are neeed because c++'s builtin .substr() method
 // does not like carriage returns '\r' at the end of the string
-std::string _sub(std::string s, int prev, int i) { 
+std::string _sub(const std::string& s, int prev, int i) {
     std::string sn = "";
 
     for (int _i=prev; _i < i; _i++) {
@@ -45,7 +52,7 @@ std::string _sub(std::string s, int prev, int i) {
 
     return sn;
 }
-std::string sub(std::string s, int prev, int i) {
+std::string sub(const std::string& s, int prev, int i) {
     if (i-prev == 1 || i == prev) {
         return std::string(1, s[prev]);
     }
@@ -55,147 +62,301 @@ std::string sub(std::string s, int prev, int i) {
 /**
  *  @brief Resets the state of the Tokenizer.
 **/
-void Tokenizer::clear() {
+template <class Sink>
+void BasicTokenizer<Sink>::clear() {
     if (this->input.size() > 0) {
         this->input.clear();
     }
-    if (this->tokens.size() > 0) {
-        this->tokens.clear();
-    }
-    this->pos = 0;
+    this->recording = nullptr;
+    this->status = TokenizeStatus::COMPLETE;
+    this->until_check = 1;  // NOTE: an expired deadline stops before the first line
 }
 
 /**
- *  @brief Tokenizer constructor. Tokenizes the input vector.
- *  @param input input to tokenize.
+ *  @brief BasicTokenizer constructor. Tokenizes the input vector into sink.
+ *  @param input input to tokenize, move it in to not hold the lines twice.
+ *  @param sink receives every Token, see token-sink.h.
+ *  @param options optional behavior, see TokenizerOptions.
 **/
-Tokenizer::Tokenizer(const std::vector<std::string>& input) {
+template <class Sink>
+BasicTokenizer<Sink>::BasicTokenizer(
+    std::vector<std::string> input,
+    Sink sink,
+    const TokenizerOptions& options
+) : sink(std::move(sink)), options(options) {
+    this->keep_values =
+        this->options.interner != nullptr ||
+        this->options.line_cache != nullptr ||
+        this->options.structure != nullptr;
     this->clear();
-    this->input = input;
+    this->input = std::move(input);
 
-    this->build_regexs();
     this->tokenize();
 }
 
 /**
- *  @brief Initializes this->regexs.
+ *  @brief BasicTokenizer constructor. Tokenizes the lines read_line gives into
+ *  sink, only the line being tokenized is held.
+ *  @param read_line gives the input one line at a time, see LineReader.
+ *  @param sink receives every Token, see token-sink.h.
+ *  @param options optional behavior, see TokenizerOptions.
 **/
-void Tokenizer::build_regexs() {
-    this->s_regex_three_double_quotes_same_line = std::regex("^(\"\"\".*\"\"\")");
-    this->s_regex_three_single_quotes_same_line = std::regex("^('''.*''')");
-
-    // NOTE: there is baked in top to bottom precedence here (top is highest)
-    this->regexs = {
-        {"OP", std::regex("^(\\()")},
-        {"OP", std::regex("^(\\))")},
-        {"OP", std::regex("^(\\[)")},
-        {"OP", std::regex("^(\\])")},
-        {"OP", std::regex("^(\\{)")},
-        {"OP", std::regex("^(\\})")},
-        {"OP", std::regex("^(==)")},
-        {"OP", std::regex("^(=)")},
-        {"OP", std::regex("^(:)")},
-        {"OP", std::regex("^(\\+)")},
-        {"OP", std::regex("^(-)")},
-        {"OP", std::regex("^(\\*\\*)")},
-        {"OP", std::regex("^(\\*)")},
-        {"OP", std::regex("^(//)")},
-        {"OP", std::regex("^(/)")},
-        // NOTE: these next 2 regex's are for multiline strings
-        // NOTE: these will also catch the start of strings like: """asd"""  (all on same line)
-        {"THREE_DOUBLE_QUOTES", std::regex("^(\"\"\")")},
-        {"THREE_SINGLE_QUOTES", std::regex("^(''')")},
-        // NOTE: the following 2 STRING regex's handle strings that terminate on the same line
-        {"STRING", std::regex("^(r?b?\".*\")")},  // NOTE: strings can be like rb"" or just ""
-        {"STRING", std::regex("^(r?b?'.*')")},  // NOTE: strings can be like rb'' or just ''
-        {"COMMENT", std::regex("^(#.*)")},
-        {"NUMBER", std::regex("^(-?[0-9.,]+)")},  // NOTE: using + and not *
-        {"NAME", std::regex("^([a-zA-Z0-9_]+)")}  // NOTE: using + and not *
-    };
+template <class Sink>
+BasicTokenizer<Sink>::BasicTokenizer(
+    LineReader read_line,
+    Sink sink,
+    const TokenizerOptions& options
+) : read_line(std::move(read_line)), sink(std::move(sink)), options(options) {
+    this->keep_values =
+        this->options.interner != nullptr ||
+        this->options.line_cache != nullptr ||
+        this->options.structure != nullptr;
+    this->clear();
+
+    this->tokenize();
 }
 
 /**
- *  @brief Applies all regexs from this->regexs until a match is found.
- *  @param line string to apply this->regexs against.
- *  @returns The match like {type, value} as a tuple.
+ *  @brief Fetches the sink, which holds the results of tokenization.
+ *  @returns this->sink.
 **/
-std::tuple<std::string, std::string> Tokenizer::apply_regexs(std::string& line) {
-    std::smatch match;
-    std::string match_type;
-    std::string match_result;
-
-    for (auto regex_tuple : this->regexs) {
-        if (std::regex_search(line, match, std::get<1>(regex_tuple))) {
-            match_type = std::get<0>(regex_tuple);
-            match_result = match[0];
-
-            // NOTE: if its ''' or """ then need to double check that
-            // it doesn't terminate on the same line
-            if (std::get<0>(regex_tuple) == "THREE_DOUBLE_QUOTES") {
-                if (std::regex_search(line, match, this->s_regex_three_double_quotes_same_line)) {
-                    match_type = "STRING";
-                    match_result = match[0];
-                }
-            }
-            else if (std::get<0>(regex_tuple) == "THREE_SINGLE_QUOTES") {
-                if (std::regex_search(line, match, this->s_regex_three_single_quotes_same_line)) {
-                    match_type = "STRING";
-                    match_result = match[0];
-                }
-            }
-            line.erase(0, match_result.size());  // NOTE: this erases match[0] as well
+template <class Sink>
+Sink& BasicTokenizer<Sink>::get_sink() {
+    return this->sink;
+}
 
-            return {match_type, match_result};
-        }    
+/**
+ *  @brief How tokenizing ended. Anything but TokenizeStatus::COMPLETE means the
+ *  sink got every Token up to where it stopped, and no NEWLINE, DEDENTs or
+ *  ENDMARKER after them. A multiline string still open there is dropped.
+ *  @returns this->status.
+**/
+template <class Sink>
+TokenizeStatus BasicTokenizer<Sink>::get_status() const {
+    return this->status;
+}
+
+/**
+ *  @brief Fetches a line of the input, lines are fetched in order.
+ *  @param line_number 0 based line number.
+ *  @returns The line, or nullptr past the last line.
+**/
+template <class Sink>
+const std::string* BasicTokenizer<Sink>::get_line(int line_number) {
+    if (this->read_line) {
+        return this->read_line(this->current_line) ? &this->current_line : nullptr;
     }
+    return line_number < (int)this->input.size() ? &this->input[line_number] : nullptr;
+}
 
-    throw std::runtime_error("No regex matched: " + line);
+/**
+ *  @brief Length of the OP at line[pos], a switch on its first byte. The
+ *  longest OP wins, "**" over "*" and "..." over ".".
+ *  @returns The length of the OP, 0 if there is none.
+**/
+static size_t scan_operator(const std::string& line, size_t pos) {
+    // NOTE: std::string keeps a '\0' at line[line.size()], so looking one or
+    // two bytes ahead never reads past the line
+    const char* next = line.c_str() + pos;
+    switch (next[0]) {
+        case '(':
+        case ')':
+        case '[':
+        case ']':
+        case '{':
+        case '}':
+        case ':':
+        case '+':
+        case '-':
+        case ',':
+            return 1;
+        case '=':
+            return next[1] == '=' ? 2 : 1;
+        case '*':
+            return next[1] == '*' ? 2 : 1;
+        case '/':
+            return next[1] == '/' ? 2 : 1;
+        case '.':
+            return next[1] == '.' && next[2] == '.' ? 3 : 1;
+        default:
+            return 0;
+    }
 }
 
 /**
- *  @brief Fetches a regex to check for the closing of a multiline string.
- *  @param type opening string type, either THREE_DOUBLE_QUOTES (""") or THREE_SINGLE_QUOTES (''').
- *  @returns A std::regex sufficient to search for the closing of the multiline string.
+ *  @brief Finds the Token starting at line[pos]: a string, number, OP,
+ *  comment or NAME, in that order. Every scan is anchored at pos and looks at
+ *  each byte of the Token a constant number of times, so tokenizing a line is
+ *  linear in its length.
+ *  @param line line being tokenized.
+ *  @param pos position of the next Token.
+ *  @returns The kind and length of the match, see value_of for its text.
 **/
-std::regex Tokenizer::get_string_close_regex(const std::string& type) {
-    if (type == "THREE_DOUBLE_QUOTES") {
-        return std::regex("\"\"\"");
+template <class Sink>
+TokenMatch BasicTokenizer<Sink>::apply_regexs(const std::string& line, size_t pos) {
+    // NOTE: strings are scanned by hand, a greedy ".*" regex backtracks to the
+    // last quote on the line and doesn't know about escaped quotes
+    StringMatch string_match = scan_string(line, pos);
+    if (string_match.type != StringScan::NONE) {
+        if (string_match.type == StringScan::STRING) {
+            return {MatchKind::STRING, string_match.length};
+        }
+        // NOTE: multiline string, the match is the rest of the line
+        if (string_match.quote == '"') {
+            return {MatchKind::THREE_DOUBLE_QUOTES, string_match.length};
+        }
+        return {MatchKind::THREE_SINGLE_QUOTES, string_match.length};
     }
-    else if (type == "THREE_SINGLE_QUOTES") {
-        return std::regex("'''");
+
+    // NOTE: before the OPs so ".5" isn't taken by the "." OP
+    NumberMatch number_match = scan_number(line, pos);
+    if (number_match.length > 0) {
+        this->number = number_match.value;
+        return {MatchKind::NUMBER, number_match.length};
     }
-    throw std::runtime_error(
-        "Unhandled type '" +
-        type +
-        "' in Tokenizer::get_string_close_regex"
-    );
+
+    size_t op_size = scan_operator(line, pos);
+    if (op_size > 0) {
+        return {MatchKind::OP, op_size};
+    }
+
+    if (line[pos] == '#') {
+        // NOTE: a comment is the rest of the line
+        return {MatchKind::COMMENT, line.size() - pos};
+    }
+
+    // NOTE: NAME accepts non-ASCII identifiers which std::regex can't classify
+    size_t name_size = scan_identifier(line, pos);
+    if (name_size > 0) {
+        return {MatchKind::NAME, name_size};
+    }
+
+    throw std::runtime_error("No regex matched: " + line.substr(pos));
 }
 
-int Tokenizer::check_string_termination(std::string line, std::regex close_regex) {
-    std::smatch match;
-    
-    if (std::regex_search(line, match, close_regex)) {
-        return match.position() + ((std::string)match[0]).size();
+/**
+ *  @brief Text of a Token, copied out of its line only if the sink or one of
+ *  the options needs it, see Sink::wants_values.
+ *  @param line line being tokenized.
+ *  @param pos start of the Token.
+ *  @param length length of the Token in bytes.
+ *  @returns The Token value, or "".
+**/
+template <class Sink>
+std::string BasicTokenizer<Sink>::value_of(const std::string& line, size_t pos, size_t length) const {
+    if constexpr (!Sink::wants_values) {
+        if (!this->keep_values) {
+            return std::string();
+        }
     }
+    return line.substr(pos, length);
+}
 
-    return -1;
+/**
+ *  @brief Checks for the closing of a multiline string.
+ *  @param line line to check.
+ *  @param quote quote character of the string, either " (""") or ' (''').
+ *  @returns The position right after the closing quotes, or -1 if the string continues.
+**/
+template <class Sink>
+int BasicTokenizer<Sink>::check_string_termination(const std::string& line, char quote) {
+    size_t end = find_string_end(line, 0, quote, true);
+
+    if (end == std::string::npos) {
+        return -1;
+    }
+    return end;
 }
 
 /**
- *  @brief Left strips whitespace from the current line in this->input.
- *  @param line_number current line being parsed.
- *  @returns The amount of stripped characters.
+ *  @brief Skips the spaces at line[pos], the line itself is never modified.
+ *  @param line line being tokenized.
+ *  @param pos current position in the line, moved past the spaces.
+ *  @returns The amount of skipped characters.
 **/
-int Tokenizer::lstrip_spaces(int line_number) {
-    int next_position = this->input[line_number].find_first_not_of(" ");
+template <class Sink>
+int BasicTokenizer<Sink>::lstrip_spaces(const std::string& line, size_t& pos) {
+    size_t next_position = line.find_first_not_of(" ", pos);
 
-    if (next_position == (int)std::string::npos) {
+    if (next_position == std::string::npos) {
         return 0;
     }
 
-    this->input[line_number].erase(0, next_position);
+    int stripped = next_position - pos;
+    pos = next_position;
 
-    return next_position;
+    return stripped;
+}
+
+/**
+ *  @brief Checks this->options.cancel and this->options.deadline, but only
+ *  every options.check_every calls, the rest are a decrement.
+ *  @returns true and sets this->status if tokenizing should stop.
+**/
+template <class Sink>
+bool BasicTokenizer<Sink>::should_stop() {
+    if (--this->until_check > 0) {
+        return false;
+    }
+    this->until_check = std::max(1, this->options.check_every);
+
+    if (this->options.cancel != nullptr && this->options.cancel->load(std::memory_order_relaxed)) {
+        this->status = TokenizeStatus::CANCELLED;
+        return true;
+    }
+    // NOTE: no clock read without a deadline
+    if (
+        this->options.deadline != std::chrono::steady_clock::time_point::max() &&
+        std::chrono::steady_clock::now() >= this->options.deadline
+    ) {
+        this->status = TokenizeStatus::DEADLINE;
+        return true;
+    }
+    return false;
+}
+
+/**
+ *  @brief Adds a Token to the line being recorded for this->options.line_cache, if any.
+ *  @param kind Token kind.
+ *  @param value Token value.
+ *  @param start starting line and column.
+ *  @param end ending line and column.
+**/
+template <class Sink>
+void BasicTokenizer<Sink>::record_token(
+    TokenKind kind,
+    const std::string& value,
+    std::tuple<int, int> start,
+    std::tuple<int, int> end,
+    const NumberValue& number
+) {
+    if (this->recording != nullptr) {
+        this->recording->tokens.push_back({kind, value, std::get<1>(start), std::get<1>(end), number});
+    }
+}
+
+/**
+ *  @brief Pushes the Tokens of a cached line as if line_number was tokenized.
+ *  @param line cached line to replay.
+ *  @param line_number current line number being tokenized.
+**/
+template <class Sink>
+void BasicTokenizer<Sink>::replay_line(const CachedLine& line, int line_number) {
+    for (const CachedToken& token : line.tokens) {
+        std::tuple<int, int> start{line_number+1, token.column_start};
+        std::tuple<int, int> end{line_number+1, token.column_end};
+
+        if (token.kind == TokenKind::NAME) {
+            // NOTE: goes through push_name so the Interner still sees it
+            this->push_name(token.value, start, end);
+        }
+        else if (token.kind == TokenKind::NUMBER) {
+            this->push_number(token.value, token.number, start, end);
+        }
+        else {
+            this->push_token(token.kind, token.value, start, end);
+        }
+    }
 }
 
 // NOTE: this function lines up pretty well with the _tokenize function from
@@ -204,7 +365,8 @@ int Tokenizer::lstrip_spaces(int line_number) {
 /**
  *  @brief Main function to kick off tokenization.
 **/
-void Tokenizer::tokenize() {
+template <class Sink>
+void BasicTokenizer<Sink>::tokenize() {
     std::vector<int> indents{0};  // NOTE: pushing the single 0 mentioned in the comments above
 
     std::tuple<int, int> start;
@@ -212,36 +374,51 @@ void Tokenizer::tokenize() {
     // NOTE: flag for multi-line strings
     bool in_string = false;
     std::string string_value;
-    std::string string_close_value;
     std::tuple<int, int> string_start;
-    std::regex string_close_regex;
+    char string_quote = 0;
 
     // NOTE: counter for opening/closing ([{
     int paren_level = 0;
-    const std::vector<std::string> open_parens{"(", "[", "{"};
-    const std::vector<std::string> close_parens{")", "]", "}"};
 
     this->push_encoding();
 
     int line_number = 0;  // NOTE: needed for eof after the loop
-    for (line_number=0; line_number < (int)this->input.size(); line_number++) {
+    const std::string* next_line = nullptr;
+    for (line_number=0; (next_line = this->get_line(line_number)) != nullptr; line_number++) {
+        // NOTE: checked per line and per Token below, every Token is linear in
+        // its length so the time past a deadline is bounded by check_every Tokens
+        if (this->should_stop()) {
+            return;
+        }
+
+        // NOTE: the line is never modified, line_pos is the byte offset of the
+        // next Token and current_pos its column
+        const std::string& line = *next_line;
+        size_t line_pos = 0;
+
         // NOTE: intentionally ommiting '\r' and '\n'
-        int current_pos = this->input[line_number].find_first_not_of("\t ");
+        int current_pos = line.find_first_not_of("\t ");
+
+        // NOTE: only lines starting outside of brackets and strings can be cached
+        bool cacheable =
+            this->options.line_cache != nullptr &&
+            !in_string &&
+            paren_level == 0 &&
+            current_pos != (int)std::string::npos;
 
         if (in_string) {
             // NOTE: checking for the termination of the current multiline string
-            int termination_pos = this->check_string_termination(
-                this->input[line_number],
-                string_close_regex
-            );
+            int termination_pos = this->check_string_termination(line, string_quote);
 
             if (termination_pos != -1) {
                 // NOTE: string terminates on this line
-                string_value += this->input[line_number].substr(0, termination_pos);
-                current_pos = termination_pos;
-                this->input[line_number].erase(0, termination_pos);
+                if constexpr (Sink::wants_values) {
+                    string_value.append(line, 0, termination_pos);
+                }
+                current_pos = utf8_width(std::string_view(line).substr(0, termination_pos));
+                line_pos = termination_pos;
                 this->push_token(
-                    "STRING",
+                    TokenKind::STRING,
                     string_value,
                     string_start,
                     {line_number+1, current_pos}
@@ -250,29 +427,31 @@ void Tokenizer::tokenize() {
             }
             else {
                 // NOTE: this line belongs to the current multiline string
-                string_value += this->input[line_number] + "\\n";
+                if constexpr (Sink::wants_values) {
+                    string_value += line + "\\n";
+                }
                 continue;
             }
         }
 
         else if (paren_level == 0) {
-            if (input[line_number].size() == 0) {
+            if (line.size() == 0) {
                 // NOTE: found an empty line
                 this->push_nl(line_number, 0);
                 continue;
             }
-            else if (input[line_number][current_pos] == '#') {
+            else if (line[current_pos] == '#') {
                 // NOTE: found a comment
-                std::string comment_value = input[line_number].substr(current_pos);
+                int comment_width = utf8_width(std::string_view(line).substr(current_pos));
                 this->push_token(
-                    "COMMENT",
-                    comment_value,
+                    TokenKind::COMMENT,
+                    this->value_of(line, current_pos, line.size() - current_pos),
                     {line_number+1, current_pos},
-                    {line_number+1, current_pos+comment_value.size()}
+                    {line_number+1, current_pos+comment_width}
                 );
                 this->push_nl(
                     line_number,
-                    current_pos+comment_value.size()
+                    current_pos+comment_width
                 );
                 continue;
             }
@@ -280,11 +459,8 @@ void Tokenizer::tokenize() {
             if (current_pos > indents.back()) {
                 // NOTE: indentation level increasing
                 indents.push_back(current_pos);
-                this->push_indent(
-                    sub(this->input[line_number], 0, current_pos),
-                    line_number
-                );
-                this->input[line_number].erase(0, current_pos);  // NOTE: erase indent
+                this->push_indent(line, current_pos, line_number);
+                line_pos = current_pos;  // NOTE: skip the indent
             }
             else if (current_pos < indents.back()) {
                 // NOTE: indentation level decreasing
@@ -302,92 +478,119 @@ void Tokenizer::tokenize() {
             }
         }
 
-        // NOTE: tokenize the line
-        bool first = true;
-        while (this->input[line_number].size() > 0) {
+        CachedLine recorded;
+        if (cacheable) {
+            std::string_view content = line;
+            content.remove_prefix(content.find_first_not_of("\t ", line_pos));
+
+            const CachedLine* cached = this->options.line_cache->find(current_pos, content);
+            if (cached != nullptr) {
+                this->replay_line(*cached, line_number);
+                continue;
+            }
+
+            recorded.indent = current_pos;
+            recorded.content = std::string(content);
+            this->recording = &recorded;
+        }
+
+        // NOTE: tokenize the line, after a multiline string closed on it
+        // current_pos is right after the string and the spaces do count
+        bool first = line_pos == 0;
+        while (line_pos < line.size()) {
+            if (this->should_stop()) {
+                this->recording = nullptr;  // NOTE: a partial line is never cached
+                return;
+            }
             if (first) {
                 // NOTE: dont want to double count the initial whitespace on a line
-                (void)this->lstrip_spaces(line_number);
+                (void)this->lstrip_spaces(line, line_pos);
                 first = false;
             }
             else {
-                current_pos += this->lstrip_spaces(line_number);
+                current_pos += this->lstrip_spaces(line, line_pos);
             }
-            auto next_match = this->apply_regexs(this->input[line_number]);
+            TokenMatch next_match = this->apply_regexs(line, line_pos);
+            std::string_view text(line.data() + line_pos, next_match.length);
+            std::string value = this->value_of(line, line_pos, next_match.length);
+            line_pos += next_match.length;
             start = {line_number+1, current_pos};
-            current_pos += std::get<1>(next_match).size();
-
-            if (
-                std::get<0>(next_match) == "NUMBER" ||
-                std::get<0>(next_match) == "COMMENT" ||
-                std::get<0>(next_match) == "NAME" ||
-                std::get<0>(next_match) == "STRING"
-            ) {
-                // NOTE: default Tokens, no extra work needed
-                this->push_token(
-                    std::get<0>(next_match),
-                    std::get<1>(next_match),
-                    start,
-                    {line_number+1, current_pos}
-                );
-            }
-            else if (
-                std::get<0>(next_match) == "THREE_DOUBLE_QUOTES" ||
-                std::get<0>(next_match) == "THREE_SINGLE_QUOTES"
-            ) {
-                // NOTE: multiline string starting
-                string_close_regex = this->get_string_close_regex(std::get<0>(next_match));
-                string_start = start;
-                string_value = std::get<1>(next_match);
-                string_close_value = std::get<1>(next_match);
-                current_pos += std::get<1>(next_match).size();
-                in_string = true;
-            }
-            else {
-                // NOTE: anything that is not an OP should be handled above
-                assert(std::get<0>(next_match) == "OP");
-
-                // NOTE: check for opening/closing characters
-                if (
-                    std::find(
-                        open_parens.begin(),
-                        open_parens.end(),
-                        std::get<1>(next_match)
-                    ) != open_parens.end()
-                ) {
-                    paren_level++;
-                }
-                else if (
-                    std::find(
-                        close_parens.begin(),
-                        close_parens.end(),
-                        std::get<1>(next_match)
-                    ) != close_parens.end()
-                ) {
-                    paren_level--;
-                    assert(paren_level >= 0);
-                }
-
-                this->push_token(
-                    std::get<0>(next_match),
-                    std::get<1>(next_match),
-                    start,
-                    {line_number+1, current_pos}
-                );
+            // NOTE: columns are in code points like python, not bytes
+            current_pos += utf8_width(text);
+
+            switch (next_match.kind) {
+                case MatchKind::NAME:
+                    this->push_name(value, start, {line_number+1, current_pos});
+                    break;
+
+                case MatchKind::NUMBER:
+                    this->push_number(value, this->number, start, {line_number+1, current_pos});
+                    break;
+
+                case MatchKind::COMMENT:
+                case MatchKind::STRING:
+                    // NOTE: default Tokens, no extra work needed
+                    this->push_token(
+                        next_match.kind == MatchKind::COMMENT ? TokenKind::COMMENT : TokenKind::STRING,
+                        value,
+                        start,
+                        {line_number+1, current_pos}
+                    );
+                    break;
+
+                case MatchKind::THREE_DOUBLE_QUOTES:
+                case MatchKind::THREE_SINGLE_QUOTES:
+                    // NOTE: multiline string starting, the match is the rest of the line
+                    string_quote = next_match.kind == MatchKind::THREE_DOUBLE_QUOTES ? '"' : '\'';
+                    string_start = start;
+                    if constexpr (Sink::wants_values) {
+                        string_value = std::move(value);
+                    }
+                    in_string = true;
+                    break;
+
+                case MatchKind::OP:
+                    // NOTE: check for opening/closing characters
+                    if (text == "(" || text == "[" || text == "{") {
+                        paren_level++;
+                    }
+                    else if (text == ")" || text == "]" || text == "}") {
+                        paren_level--;
+                        assert(paren_level >= 0);
+                    }
+
+                    this->push_token(
+                        TokenKind::OP,
+                        value,
+                        start,
+                        {line_number+1, current_pos}
+                    );
+                    break;
             }
         }
 
         // NOTE: done tokenizing the line, push a NL/NEWLINE
-        if (paren_level > 0) {
-            this->push_nl(line_number, current_pos);
-        } else {
-            if (in_string) {
+        // unless the line ends inside of a multiline string
+        if (in_string) {
+            if constexpr (Sink::wants_values) {
                 string_value += "\\n";
-            } else {
-                this->push_newline(line_number, current_pos);
             }
         }
-        
+        else if (paren_level > 0) {
+            this->push_nl(line_number, current_pos);
+        }
+        else {
+            this->push_newline(line_number, current_pos);
+        }
+
+        if (this->recording != nullptr) {
+            this->recording = nullptr;
+            // NOTE: lines that leave a bracket or string open change the state for the next line
+            if (paren_level == 0 && !in_string) {
+                this->options.line_cache->insert(std::move(recorded));
+            }
+        }
+
     }
 
     // NOTE: done tokenizing the file, cleanup and push ENDMARKER
@@ -395,104 +598,185 @@ void Tokenizer::tokenize() {
 }
 
 /**
- *  @brief Pushes an ENCODING Token to this->tokens.
+ *  @brief Hands a Token to this->sink, every Token goes through here.
+ *  @param kind Token kind.
+ *  @param value Token value.
+ *  @param start starting line and column.
+ *  @param end ending line and column.
+ *  @param attributes extra Token information.
 **/
-void Tokenizer::push_encoding() {
-    this->tokens.push_back(Token("ENCODING", "utf-8", {0, 0}, {0, 0}));
+template <class Sink>
+void BasicTokenizer<Sink>::emit(
+    TokenKind kind,
+    const std::string& value,
+    std::tuple<int, int> start,
+    std::tuple<int, int> end,
+    const TokenAttributes& attributes
+) {
+    if (this->options.structure != nullptr) {
+        this->options.structure->add(kind, value);
+    }
+    this->sink.push(kind, value, start, end, attributes);
+}
+
+/**
+ *  @brief Pushes an ENCODING Token to this->sink.
+**/
+template <class Sink>
+void BasicTokenizer<Sink>::push_encoding() {
+    this->emit(TokenKind::ENCODING, "utf-8", {0, 0}, {0, 0}, TokenAttributes());
 }
 
 /**
- *  @brief Pushes a Token based on inputs to this->tokens.
- *  @param type Token type.
+ *  @brief Pushes a Token based on inputs to this->sink.
+ *  @param kind Token kind.
  *  @param value Token value.
  *  @param start starting line and column.
  *  @param end ending line and column.
 **/
-void Tokenizer::push_token(
-    std::string type,
-    std::string value,
+template <class Sink>
+void BasicTokenizer<Sink>::push_token(
+    TokenKind kind,
+    const std::string& value,
     std::tuple<int, int> start,
     std::tuple<int, int> end
 ) {
-    this->tokens.push_back(Token(type, value, start, end));
+    this->record_token(kind, value, start, end);
+    this->emit(kind, value, start, end, TokenAttributes());
 }
 
 /**
- *  @brief Pushes an INDENT Token based on inputs to this->tokens.
+ *  @brief Pushes a NAME Token to this->sink with its Keyword, interning it if
+ *  there is an Interner.
  *  @param value Token value.
+ *  @param start starting line and column.
+ *  @param end ending line and column.
+**/
+template <class Sink>
+void BasicTokenizer<Sink>::push_name(
+    const std::string& value,
+    std::tuple<int, int> start,
+    std::tuple<int, int> end
+) {
+    this->record_token(TokenKind::NAME, value, start, end);
+
+    TokenAttributes attributes;
+    attributes.keyword = classify_keyword(value);
+    if (this->options.interner != nullptr) {
+        attributes.name_id = this->options.interner->intern(value, &attributes.name);
+    }
+    this->emit(TokenKind::NAME, value, start, end, attributes);
+}
+
+/**
+ *  @brief Pushes a NUMBER Token to this->sink with its decoded value.
+ *  @param value Token value.
+ *  @param number value decoded by scan_number.
+ *  @param start starting line and column.
+ *  @param end ending line and column.
+**/
+template <class Sink>
+void BasicTokenizer<Sink>::push_number(
+    const std::string& value,
+    const NumberValue& number,
+    std::tuple<int, int> start,
+    std::tuple<int, int> end
+) {
+    this->record_token(TokenKind::NUMBER, value, start, end, number);
+
+    TokenAttributes attributes;
+    attributes.number = number;
+    this->emit(TokenKind::NUMBER, value, start, end, attributes);
+}
+
+/**
+ *  @brief Pushes an INDENT Token based on inputs to this->sink.
+ *  @param line line being tokenized, its first indent_size characters are the Token value.
+ *  @param indent_size size of the indentation.
  *  @param line_number current line number being tokenized.
 **/
-void Tokenizer::push_indent(std::string value, int line_number) {
-    this->tokens.push_back(
-        Token(
-            "INDENT",
-            value,
-            {line_number+1, 0},
-            {line_number+1, value.size()}
-        )
+template <class Sink>
+void BasicTokenizer<Sink>::push_indent(const std::string& line, int indent_size, int line_number) {
+    std::string value;
+    if constexpr (Sink::wants_values) {
+        value = sub(line, 0, indent_size);
+    }
+    this->emit(
+        TokenKind::INDENT,
+        value,
+        {line_number+1, 0},
+        {line_number+1, indent_size},
+        TokenAttributes()
     );
 }
 
 /**
- *  @brief Pushes a DEDENT Token based on inputs to this->tokens.
+ *  @brief Pushes a DEDENT Token based on inputs to this->sink.
  *  @param line_number current line number being tokenized.
 **/
-void Tokenizer::push_dedent(int line_number) {
-    this->tokens.push_back(
-        Token(
-            "DEDENT",
-            "",
-            {line_number+1, 0},
-            {line_number+1, 0}
-        )
+template <class Sink>
+void BasicTokenizer<Sink>::push_dedent(int line_number) {
+    this->emit(
+        TokenKind::DEDENT,
+        "",
+        {line_number+1, 0},
+        {line_number+1, 0},
+        TokenAttributes()
     );
 }
 
 /**
- *  @brief Pushes a NEWLINE Token to this->tokens.
+ *  @brief Pushes a NEWLINE Token to this->sink.
  *  @param line_number current line number being tokenized.
  *  @param current_pos current position in the line.
 **/
-void Tokenizer::push_newline(int line_number, int current_pos) {
-    this->tokens.push_back(
-        Token(
-            "NEWLINE",
-            "\\n",
-            {line_number+1, current_pos},
-            {line_number+1, current_pos+1}
-        )
+template <class Sink>
+void BasicTokenizer<Sink>::push_newline(int line_number, int current_pos) {
+    this->record_token(
+        TokenKind::NEWLINE,
+        "\\n",
+        {line_number+1, current_pos},
+        {line_number+1, current_pos+1}
+    );
+    this->emit(
+        TokenKind::NEWLINE,
+        "\\n",
+        {line_number+1, current_pos},
+        {line_number+1, current_pos+1},
+        TokenAttributes()
     );
 }
 
 /**
- *  @brief Pushes a NL Token to this->tokens.
+ *  @brief Pushes a NL Token to this->sink.
  *  @param line_number current line number being tokenized.
  *  @param current_pos current position in the line.
 **/
-void Tokenizer::push_nl(int line_number, int current_pos) {
-    this->tokens.push_back(
-        Token(
-            "NL",
-            "\\n",
-            {line_number+1, current_pos},
-            {line_number+1, current_pos+1}
-        )
+template <class Sink>
+void BasicTokenizer<Sink>::push_nl(int line_number, int current_pos) {
+    this->emit(
+        TokenKind::NL,
+        "\\n",
+        {line_number+1, current_pos},
+        {line_number+1, current_pos+1},
+        TokenAttributes()
     );
 }
 
 /**
- *  @brief Pushes an ENDMARKER Token to this->tokens.
+ *  @brief Pushes an ENDMARKER Token to this->sink.
  *  @param indents current INDENT stack.
  *  @param line_number current line number being tokenized.
 **/
-void Tokenizer::push_eof(std::vector<int> indents, int line_number) {
+template <class Sink>
+void BasicTokenizer<Sink>::push_eof(std::vector<int> indents, int line_number) {
     while (indents.size() > 1) {
         // NOTE: the 0 on the stack should never be popped
         this->push_dedent(line_number);
         indents.pop_back();
     }
     this->push_token(
-        "ENDMARKER",
+        TokenKind::ENDMARKER,
         "",
         {line_number+1, 0},
         {line_number+1, 0}
@@ -500,33 +784,77 @@ void Tokenizer::push_eof(std::vector<int> indents, int line_number) {
 }
 
 /**
- *  @brief Fetches a Token from this->tokens at position i.
+ *  @brief Name of a TokenizeStatus, e.g. "DEADLINE".
+**/
+const std::string& tokenize_status_name(TokenizeStatus status) {
+    static const std::string names[] = {"COMPLETE", "DEADLINE", "CANCELLED"};
+    return names[(int)status];
+}
+
+// NOTE: every sink from token-sink.h the tokenizer can be used with
+template class BasicTokenizer<VectorSink>;
+template class BasicTokenizer<CountingSink>;
+template class BasicTokenizer<FilterSink>;
+template class BasicTokenizer<CallbackSink>;
+template class BasicTokenizer<ChunkSink>;
+template class BasicTokenizer<BatchingSink>;
+template class BasicTokenizer<SpanSink>;
+template class BasicTokenizer<FingerprintSink>;
+
+/**
+ *  @brief Tokenizer constructor. Tokenizes the input vector.
+ *  @param input input to tokenize, move it in to not hold the lines twice.
+ *  @param options optional behavior, see TokenizerOptions.
+**/
+Tokenizer::Tokenizer(std::vector<std::string> input, const TokenizerOptions& options)
+    : BasicTokenizer<VectorSink>(std::move(input), VectorSink(), options), pos(0) {}
+
+/**
+ *  @brief Fetches a Token from this->sink.tokens at position i.
  *  @param i index of Token to fetch.
- *  @returns Token at position i in this->tokens, or Token() if oob.
+ *  @returns Token at position i in this->sink.tokens, or Token() if oob.
 **/
 Token Tokenizer::at(int i) {
-    if (i >= 0 && i < (int)this->tokens.size()) {
-        return this->tokens.at(i);
+    if (i >= 0 && i < (int)this->sink.tokens.size()) {
+        return this->sink.tokens.at(i);
     }
     return Token();
 }
 
 /**
- *  @brief Returns the next Token from this->tokens. Increments this->pos.
+ *  @brief Returns the next Token from this->sink.tokens. Increments this->pos.
  *  @returns The next Token.
 **/
 Token Tokenizer::next_token() {
-    if (this->pos < (int)this->tokens.size()) {
-        return this->tokens[this->pos++];
+    if (this->pos < (int)this->sink.tokens.size()) {
+        return this->sink.tokens[this->pos++];
     }
     throw std::runtime_error("next_token() with no tokens remaining");
 }
 
 /**
- *  @brief Prints all tokens in this->tokens to std::cout.
+ *  @brief Number of Tokens in this->sink.tokens.
+ *  @returns The size of this->sink.tokens.
+**/
+int Tokenizer::size() const {
+    return this->sink.tokens.size();
+}
+
+/**
+ *  @brief Prints all tokens in this->sink.tokens to std::cout.
 **/
 void Tokenizer::print() {
-    for (Token t : this->tokens) {
-        std::cout << t << std::endl;
+    // NOTE: formats into one buffer written every 64KB, not a flush per Token
+    std::string buffer;
+    buffer.reserve(64 * 1024 + 256);
+    for (const Token& t : this->sink.tokens) {
+        append_formatted_token(buffer, t);
+        buffer += '\n';
+        if (buffer.size() >= 64 * 1024) {
+            std::cout.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
     }
+    std::cout.write(buffer.data(), buffer.size());
+    std::cout.flush();
 }
@@ -4,51 +4,173 @@
 #include <string>
 #include <vector>
 #include <tuple>
-#include <regex>
+#include <chrono>
+#include <atomic>
+#include <functional>
 #include "token.h"
+#include "token-sink.h"
+#include "interner.h"
+#include "line-cache.h"
+#include "structure-index.h"
 
 /**
- *  @brief Tokenizes a given vector<string> input.
+ *  @brief How tokenizing ended, see TokenizerOptions::deadline and cancel.
 **/
-class Tokenizer {
-    private:
-        int pos;
-        std::vector<std::tuple<std::string, std::regex>> regexs;
-        std::regex s_regex_three_double_quotes_same_line;
-        std::regex s_regex_three_single_quotes_same_line;
+enum class TokenizeStatus {
+    COMPLETE,
+    DEADLINE,   // NOTE: stopped because options.deadline passed
+    CANCELLED   // NOTE: stopped because *options.cancel was set
+};
+
+const std::string& tokenize_status_name(TokenizeStatus status);
+
+/**
+ *  @brief Optional tokenizer behavior, everything is off by default.
+**/
+struct TokenizerOptions {
+    // NOTE: gives NAME Tokens a name_id, can be shared between Tokenizers
+    Interner* interner = nullptr;
+    // NOTE: replays repeated lines instead of re-matching them, can be shared between Tokenizers
+    LineCache* line_cache = nullptr;
+    // NOTE: gets bracket matches, logical lines and blocks, one per Tokenizer
+    StructureIndex* structure = nullptr;
+    // NOTE: stop early once the deadline passes or *cancel is set. Both are only
+    // checked every check_every lines or Tokens, see get_status()
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    const std::atomic<bool>* cancel = nullptr;
+    int check_every = 64;
+};
+
+/**
+ *  @brief What apply_regexs found at a position of a line.
+**/
+enum class MatchKind {
+    NAME,
+    NUMBER,
+    STRING,
+    COMMENT,
+    OP,
+    THREE_DOUBLE_QUOTES,  // NOTE: a multiline string starts, the match is the rest of the line
+    THREE_SINGLE_QUOTES
+};
+
+/**
+ *  @brief A match of apply_regexs, the Token is length bytes of the line
+ *  from where it looked. Only copied out of the line if a value is needed.
+**/
+struct TokenMatch {
+    MatchKind kind;
+    size_t length;
+};
+
+// NOTE: gets the next line of the input without its '\n', false past the last
+// line. Lets a Tokenizer read its input one line at a time, see BasicTokenizer.
+using LineReader = std::function<bool(std::string& line)>;
+
+/**
+ *  @brief Tokenizes a given vector<string> input, every Token goes to Sink::push.
+ *  See token-sink.h for the available sinks.
+**/
+template <class Sink>
+class BasicTokenizer {
+    protected:
         std::vector<std::string> input;
-        std::vector<Token> tokens;
+        LineReader read_line;  // NOTE: used instead of input if set
+        std::string current_line;  // NOTE: last line read_line gave
+        Sink sink;
+        TokenizerOptions options;
+        CachedLine* recording;  // NOTE: line being recorded for options.line_cache
+        TokenizeStatus status;
+        int until_check;  // NOTE: should_stop() calls left until it really checks
+        NumberValue number;  // NOTE: value of the last NUMBER apply_regexs matched
+        // NOTE: the interner, line cache and structure index need Token values
+        // even when the sink doesn't
+        bool keep_values;
 
         // tokenize utilities
         void clear();
-        void build_regexs();
-        std::tuple<std::string, std::string> apply_regexs(std::string& line);
-        std::regex get_string_close_regex(const std::string& type);
-        int check_string_termination(std::string line, std::regex close_regex);
-        int lstrip_spaces(int line_number);
+        const std::string* get_line(int line_number);
+        TokenMatch apply_regexs(const std::string& line, size_t pos);
+        std::string value_of(const std::string& line, size_t pos, size_t length) const;
+        int check_string_termination(const std::string& line, char quote);
+        int lstrip_spaces(const std::string& line, size_t& pos);
+        void record_token(
+            TokenKind kind,
+            const std::string& value,
+            std::tuple<int, int> start,
+            std::tuple<int, int> end,
+            const NumberValue& number = NumberValue()
+        );
+        void replay_line(const CachedLine& line, int line_number);
+        bool should_stop();
 
         // main tokenization function
         void tokenize();
 
         // Token push functions
+        void emit(
+            TokenKind kind,
+            const std::string& value,
+            std::tuple<int, int> start,
+            std::tuple<int, int> end,
+            const TokenAttributes& attributes
+        );
         void push_encoding();
         void push_newline(int line_number, int current_pos);
         void push_nl(int line_number, int current_pos);
         void push_token(
-            std::string type,
-            std::string value,
+            TokenKind kind,
+            const std::string& value,
+            std::tuple<int, int> start,
+            std::tuple<int, int> end
+        );
+        void push_name(
+            const std::string& value,
             std::tuple<int, int> start,
             std::tuple<int, int> end
         );
-        void push_indent(std::string value, int line_number);
+        void push_number(
+            const std::string& value,
+            const NumberValue& number,
+            std::tuple<int, int> start,
+            std::tuple<int, int> end
+        );
+        void push_indent(const std::string& line, int indent_size, int line_number);
         void push_dedent(int line_number);
         void push_eof(std::vector<int> indents, int line_number);
 
     public:
-        explicit Tokenizer(const std::vector<std::string>& input);
+        explicit BasicTokenizer(
+            std::vector<std::string> input,
+            Sink sink = Sink(),
+            const TokenizerOptions& options = TokenizerOptions()
+        );
+        explicit BasicTokenizer(
+            LineReader read_line,
+            Sink sink = Sink(),
+            const TokenizerOptions& options = TokenizerOptions()
+        );
+
+        Sink& get_sink();
+        TokenizeStatus get_status() const;
+};
+
+/**
+ *  @brief Tokenizes a given vector<string> input and keeps every Token.
+**/
+class Tokenizer : public BasicTokenizer<VectorSink> {
+    private:
+        int pos;
+
+    public:
+        explicit Tokenizer(
+            std::vector<std::string> input,
+            const TokenizerOptions& options = TokenizerOptions()
+        );
 
         Token at(int i);
         Token next_token();
+        int size() const;
         void print();
 };
 
@@ -0,0 +1,98 @@
+#ifndef SPAN_SINK_H
+#define SPAN_SINK_H
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <algorithm>
+#include "token.h"
+#include "regex-tokenizer-c.h"
+
+// NOTE: the C++ side of the C ABI, kept out of token-sink.h so the
+// tokenizer's headers don't depend on regex-tokenizer-c.h
+
+/**
+ *  @brief Stores every Token as an rtok_token, a kind and a byte range of the
+ *  tokenized buffer instead of a copy of its text. What the C ABI exports,
+ *  see regex-tokenizer-c.h. Columns are mapped to bytes in the caller's
+ *  buffer, the sink keeps no copy of the lines.
+**/
+struct SpanSink {
+    static constexpr bool wants_values = false;
+
+    const char* buffer;
+    const std::vector<size_t>* line_offsets;  // NOTE: offset of every line in the buffer, then the buffer size
+    std::vector<rtok_token>* spans;
+
+    // NOTE: last column converted to bytes, Tokens on a line come left to right
+    // so the conversion only walks forward
+    int cursor_line = -1;
+    int cursor_column = 0;
+    size_t cursor_byte = 0;
+
+    explicit SpanSink(
+        const char* buffer = nullptr,
+        const std::vector<size_t>* line_offsets = nullptr,
+        std::vector<rtok_token>* spans = nullptr
+    ) : buffer(buffer), line_offsets(line_offsets), spans(spans) {}
+
+    /**
+     *  @brief Offset in the buffer of a line and column (in code points).
+     *  A column past the end of the line is in its newline.
+    **/
+    size_t offset_of(int line, int column) {
+        if (line <= 0) {
+            return 0;
+        }
+        // NOTE: whitespace only lines report column -1 for their NL
+        column = std::max(column, 0);
+        if (line >= (int)this->line_offsets->size()) {
+            return this->line_offsets->back();
+        }
+
+        size_t line_start = (*this->line_offsets)[line-1];
+        size_t line_end = (*this->line_offsets)[line];
+        if (line_end > line_start && this->buffer[line_end-1] == '\n') {
+            line_end--;
+        }
+        const char* text = this->buffer + line_start;
+        size_t text_size = line_end - line_start;
+        if (line != this->cursor_line || column < this->cursor_column) {
+            this->cursor_line = line;
+            this->cursor_column = 0;
+            this->cursor_byte = 0;
+        }
+        while (this->cursor_column < column && this->cursor_byte < text_size) {
+            // NOTE: skip one code point, its continuation bytes are 10xxxxxx
+            this->cursor_byte++;
+            while (this->cursor_byte < text_size && ((unsigned char)text[this->cursor_byte] & 0xC0) == 0x80) {
+                this->cursor_byte++;
+            }
+            this->cursor_column++;
+        }
+
+        size_t offset = line_start + this->cursor_byte + (column - this->cursor_column);
+        return std::min(offset, (*this->line_offsets)[line]);
+    }
+
+    void push(
+        TokenKind kind,
+        const std::string&,
+        std::tuple<int, int> start,
+        std::tuple<int, int> end,
+        const TokenAttributes&
+    ) {
+        size_t start_offset = this->offset_of(std::get<0>(start), std::get<1>(start));
+        size_t end_offset = this->offset_of(std::get<0>(end), std::get<1>(end));
+
+        rtok_token span;
+        span.kind = (uint32_t)kind;
+        span.line = std::get<0>(start);
+        span.col = std::max(std::get<1>(start), 0);
+        span.length = end_offset - start_offset;
+        span.offset = start_offset;
+        this->spans->push_back(span);
+    }
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+
+/**
+ *  @brief Bounded lock-free queue for exactly one producer and one consumer thread.
+ *  head is only written by the consumer and tail only by the producer, each
+ *  on its own cache line so the two threads don't fight over it.
+**/
+template <class T>
+class SpscQueue {
+    private:
+        std::vector<T> slots;
+        size_t mask;
+        alignas(64) std::atomic<size_t> head;
+        alignas(64) std::atomic<size_t> tail;
+
+    public:
+        /**
+         *  @brief SpscQueue constructor.
+         *  @param capacity max amount of queued items, rounded up to a power of 2.
+        **/
+        explicit SpscQueue(size_t capacity) : head(0), tail(0) {
+            size_t size = 1;
+            while (size < capacity) {
+                size *= 2;
+            }
+            this->slots.resize(size);
+            this->mask = size - 1;
+        }
+
+        // not copyable, the threads hold on to this
+        SpscQueue(const SpscQueue&) = delete;
+        void operator=(const SpscQueue&) = delete;
+
+        /**
+         *  @brief Producer side. Moves value into the queue unless it is full.
+         *  @returns false if the queue is full, value is left untouched.
+        **/
+        bool try_push(T& value) {
+            size_t t = this->tail.load(std::memory_order_relaxed);
+            if (t - this->head.load(std::memory_order_acquire) == this->slots.size()) {
+                return false;
+            }
+            this->slots[t & this->mask] = std::move(value);
+            this->tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         *  @brief Consumer side. Moves the oldest item out of the queue.
+         *  @returns false if the queue is empty.
+        **/
+        bool try_pop(T& value) {
+            size_t h = this->head.load(std::memory_order_relaxed);
+            if (h == this->tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+            value = std::move(this->slots[h & this->mask]);
+            this->head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t capacity() const {
+            return this->slots.size();
+        }
+};
+
+#endif
@@ -0,0 +1,117 @@
+#include <string>
+#include <cstddef>
+#include "string-scanner.h"
+
+// NOTE: string literal grammar
+// https://docs.python.org/3/reference/lexical_analysis.html#string-and-bytes-literals
+// every scan here looks at each byte at most once, so it is linear in the
+// length of the literal no matter how many quotes follow it on the line
+
+static bool is_prefix_char(char c) {
+    switch (c) {
+        case 'r': case 'R':
+        case 'u': case 'U':
+        case 'f': case 'F':
+        case 'b': case 'B':
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool is_quote(char c) {
+    return c == '"' || c == '\'';
+}
+
+/**
+ *  @brief Finds the string prefix (r, u, f, b, br, rb, fr, rf in any case) at line[pos].
+ *  @param line line to scan.
+ *  @param pos position of the possible prefix.
+ *  @returns The length of the prefix if it is followed by a quote, else 0.
+ *  0 is also returned for a bare quote, check line[pos] for that.
+**/
+size_t string_prefix_length(const std::string& line, size_t pos) {
+    if (pos + 1 < line.size() && is_prefix_char(line[pos]) && is_quote(line[pos+1])) {
+        return 1;
+    }
+
+    if (pos + 2 < line.size() && is_prefix_char(line[pos]) && is_prefix_char(line[pos+1]) && is_quote(line[pos+2])) {
+        char first = line[pos] | 0x20;  // NOTE: lower case
+        char second = line[pos+1] | 0x20;
+        bool valid =
+            (first == 'b' && second == 'r') ||
+            (first == 'r' && second == 'b') ||
+            (first == 'f' && second == 'r') ||
+            (first == 'r' && second == 'f');
+        return valid ? 2 : 0;
+    }
+
+    return 0;
+}
+
+/**
+ *  @brief Finds the first unescaped closing quote(s) at or after line[pos].
+ *  A backslash always skips the next character, in raw strings too (r"\"" is
+ *  one string), so the same scan works for every prefix.
+ *  @param line line to scan.
+ *  @param pos position right after the opening quote(s).
+ *  @param quote ' or ".
+ *  @param triple look for ''' or """ instead of a single quote.
+ *  @returns The position right after the closing quote(s), or std::string::npos.
+**/
+size_t find_string_end(const std::string& line, size_t pos, char quote, bool triple) {
+    size_t size = line.size();
+
+    for (size_t i=pos; i < size; i++) {
+        char c = line[i];
+
+        if (c == '\\') {
+            i++;
+            continue;
+        }
+        if (c != quote) {
+            continue;
+        }
+        if (!triple) {
+            return i + 1;
+        }
+        if (i + 2 < size && line[i+1] == quote && line[i+2] == quote) {
+            return i + 3;
+        }
+    }
+
+    return std::string::npos;
+}
+
+/**
+ *  @brief Scans the string literal starting at line[pos], prefix included.
+ *  @param line line to scan.
+ *  @param pos position to start at.
+ *  @returns StringScan::NONE if there is no complete literal at pos. A ''' or
+ *  """ literal that doesn't close on this line is StringScan::OPEN_TRIPLE and
+ *  takes the rest of the line.
+**/
+StringMatch scan_string(const std::string& line, size_t pos) {
+    size_t quote_pos = pos + string_prefix_length(line, pos);
+    if (quote_pos >= line.size() || !is_quote(line[quote_pos])) {
+        return {StringScan::NONE, 0, 0};
+    }
+
+    char quote = line[quote_pos];
+    bool triple =
+        quote_pos + 2 < line.size() &&
+        line[quote_pos+1] == quote &&
+        line[quote_pos+2] == quote;
+    size_t body = quote_pos + (triple ? 3 : 1);
+    size_t end = find_string_end(line, body, quote, triple);
+
+    if (end != std::string::npos) {
+        return {StringScan::STRING, end - pos, quote};
+    }
+    if (triple) {
+        return {StringScan::OPEN_TRIPLE, line.size() - pos, quote};
+    }
+
+    // NOTE: unterminated single quoted string
+    return {StringScan::NONE, 0, 0};
+}
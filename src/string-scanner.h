@@ -0,0 +1,23 @@
+#ifndef STRING_SCANNER_H
+#define STRING_SCANNER_H
+
+#include <string>
+#include <cstddef>
+
+enum class StringScan {
+    NONE,           // NOTE: no string literal at pos
+    STRING,         // NOTE: string literal that closes on the same line
+    OPEN_TRIPLE     // NOTE: ''' or """ string that continues on the next line
+};
+
+struct StringMatch {
+    StringScan type;
+    size_t length;  // NOTE: bytes matched, for OPEN_TRIPLE the rest of the line
+    char quote;     // NOTE: ' or "
+};
+
+size_t string_prefix_length(const std::string& line, size_t pos);
+size_t find_string_end(const std::string& line, size_t pos, char quote, bool triple);
+StringMatch scan_string(const std::string& line, size_t pos);
+
+#endif
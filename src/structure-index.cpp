@@ -0,0 +1,101 @@
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "token.h"
+#include "structure-index.h"
+
+/**
+ *  @brief StructureIndex constructor, an empty index.
+**/
+StructureIndex::StructureIndex() : line_begin(NO_TOKEN) {}
+
+/**
+ *  @brief Adds the next Token of the stream.
+ *  @param kind Token kind.
+ *  @param value Token value, only looked at for OPs.
+**/
+void StructureIndex::add(TokenKind kind, const std::string& value) {
+    uint32_t token = this->matches.size();
+    this->matches.push_back(NO_TOKEN);
+
+    switch (kind) {
+        case TokenKind::OP:
+            if (value == "(" || value == "[" || value == "{") {
+                this->open_brackets.push_back(token);
+            }
+            else if ((value == ")" || value == "]" || value == "}") && !this->open_brackets.empty()) {
+                uint32_t open = this->open_brackets.back();
+                this->open_brackets.pop_back();
+                this->matches[open] = token;
+                this->matches[token] = open;
+            }
+            break;
+
+        case TokenKind::INDENT:
+            // NOTE: end is filled in by the matching DEDENT
+            this->open_blocks.push_back(this->indented_blocks.size());
+            this->indented_blocks.push_back({token, NO_TOKEN});
+            break;
+
+        case TokenKind::DEDENT:
+            if (!this->open_blocks.empty()) {
+                this->indented_blocks[this->open_blocks.back()].end = token + 1;
+                this->open_blocks.pop_back();
+            }
+            break;
+
+        case TokenKind::NEWLINE:
+            if (this->line_begin != NO_TOKEN) {
+                this->lines.push_back({this->line_begin, token + 1});
+                this->line_begin = NO_TOKEN;
+            }
+            return;
+
+        default:
+            break;
+    }
+
+    // NOTE: a logical line starts at its first Token that isn't layout or a comment
+    bool layout =
+        kind == TokenKind::ENCODING ||
+        kind == TokenKind::COMMENT ||
+        kind == TokenKind::NL ||
+        kind == TokenKind::INDENT ||
+        kind == TokenKind::DEDENT ||
+        kind == TokenKind::ENDMARKER;
+    if (!layout && this->line_begin == NO_TOKEN) {
+        this->line_begin = token;
+    }
+}
+
+/**
+ *  @brief The matching bracket of a Token.
+ *  @param token Token index.
+ *  @returns The index of the matching bracket, or NO_TOKEN if token isn't a
+ *  bracket or was never closed.
+**/
+uint32_t StructureIndex::matching_bracket(uint32_t token) const {
+    return token < this->matches.size() ? this->matches[token] : NO_TOKEN;
+}
+
+/**
+ *  @brief Token ranges of the logical lines, in order, each ending with its NEWLINE.
+**/
+const std::vector<TokenRange>& StructureIndex::logical_lines() const {
+    return this->lines;
+}
+
+/**
+ *  @brief Token ranges from every INDENT to its DEDENT, sorted by INDENT.
+ *  end is NO_TOKEN for a block that was still open when tokenizing stopped early.
+**/
+const std::vector<TokenRange>& StructureIndex::blocks() const {
+    return this->indented_blocks;
+}
+
+/**
+ *  @brief Number of Tokens added.
+**/
+size_t StructureIndex::size() const {
+    return this->matches.size();
+}
@@ -0,0 +1,54 @@
+#ifndef STRUCTURE_INDEX_H
+#define STRUCTURE_INDEX_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "token.h"
+
+// NOTE: Token index that doesn't exist, e.g. the match of an unclosed bracket
+const uint32_t NO_TOKEN = UINT32_MAX;
+
+/**
+ *  @brief Range of Token indices, end is one past the last Token.
+**/
+struct TokenRange {
+    uint32_t begin;
+    uint32_t end;
+};
+
+/**
+ *  @brief Structure of a Token stream, built while tokenizing (see
+ *  TokenizerOptions::structure) from the bracket and indentation state the
+ *  tokenizer tracks anyway. Token indices count every Token pushed to the
+ *  sink, ENCODING is 0, so they are indices into Tokenizer::at().
+ *
+ *  - matching_bracket: the other half of every ( [ { ) ] }
+ *  - logical_lines: first Token of every logical line up to its NEWLINE,
+ *    comment only and blank lines aren't logical lines
+ *  - blocks: every INDENT up to its DEDENT, sorted by INDENT, so an
+ *    indented block can be skipped without looking at its Tokens
+ *
+ *  One StructureIndex per tokenized input.
+**/
+class StructureIndex {
+    private:
+        std::vector<uint32_t> matches;  // NOTE: per Token, NO_TOKEN if not a bracket
+        std::vector<TokenRange> lines;
+        std::vector<TokenRange> indented_blocks;
+        std::vector<uint32_t> open_brackets;
+        std::vector<uint32_t> open_blocks;  // NOTE: positions in this->indented_blocks
+        uint32_t line_begin;
+
+    public:
+        StructureIndex();
+
+        void add(TokenKind kind, const std::string& value);
+
+        uint32_t matching_bracket(uint32_t token) const;
+        const std::vector<TokenRange>& logical_lines() const;
+        const std::vector<TokenRange>& blocks() const;
+        size_t size() const;
+};
+
+#endif
@@ -0,0 +1,230 @@
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include "token.h"
+#include "structure-index.h"
+#include "token-diff.h"
+
+// NOTE: Myers' O(ND) diff ("An O(ND) Difference Algorithm and Its
+// Variations", 1986) in linear space: find the middle snake of the shortest
+// edit script by searching forward from the start and backward from the end
+// at once, split there and recurse on both halves. Tokens are compared by
+// fingerprint only, a 64 bit collision between two different Tokens is
+// treated as equal.
+
+class TokenDiff {
+    private:
+        const uint64_t* a;
+        const uint64_t* b;
+        size_t max_cost;
+        std::vector<TokenEdit> edits;
+
+        // NOTE: furthest reaching x per diagonal, reused by every bisect
+        std::vector<int64_t> forward;
+        std::vector<int64_t> backward;
+
+        void add(uint32_t a_begin, uint32_t a_end, uint32_t b_begin, uint32_t b_end);
+        bool bisect(uint32_t a_begin, uint32_t a_end, uint32_t b_begin, uint32_t b_end, uint32_t& x, uint32_t& y);
+
+    public:
+        TokenDiff(const uint64_t* a, const uint64_t* b, size_t max_cost)
+            : a(a), b(b), max_cost(max_cost) {}
+
+        void diff(uint32_t a_begin, uint32_t a_end, uint32_t b_begin, uint32_t b_end);
+        std::vector<TokenEdit> get_edits() { return std::move(this->edits); }
+};
+
+/**
+ *  @brief Appends an edit, merged with the previous one when they touch so a
+ *  deletion right before an insertion becomes one replacement.
+**/
+void TokenDiff::add(uint32_t a_begin, uint32_t a_end, uint32_t b_begin, uint32_t b_end) {
+    if (!this->edits.empty()) {
+        TokenEdit& last = this->edits.back();
+        if (last.old_tokens.end == a_begin && last.new_tokens.end == b_begin) {
+            last.old_tokens.end = a_end;
+            last.new_tokens.end = b_end;
+            return;
+        }
+    }
+    this->edits.push_back(TokenEdit{{a_begin, a_end}, {b_begin, b_end}});
+}
+
+/**
+ *  @brief Finds the middle snake of a[a_begin, a_end) vs b[b_begin, b_end),
+ *  both non empty with no common prefix or suffix.
+ *  @param x, y get the split point, relative to a_begin and b_begin.
+ *  @returns false if there is no common Token to split at.
+**/
+bool TokenDiff::bisect(uint32_t a_begin, uint32_t a_end, uint32_t b_begin, uint32_t b_end, uint32_t& x, uint32_t& y) {
+    const uint64_t* a = this->a + a_begin;
+    const uint64_t* b = this->b + b_begin;
+    const int64_t n = a_end - a_begin;
+    const int64_t m = b_end - b_begin;
+    const int64_t max_d = std::min<int64_t>((n + m + 1) / 2, this->max_cost);
+    const int64_t offset = max_d + 1;
+    const int64_t delta = n - m;
+    const bool odd = delta % 2 != 0;
+
+    // NOTE: diagonal k = x - y lives at offset + k, k in [-max_d - 1, max_d + 1]
+    this->forward.assign(2 * offset + 1, -1);
+    this->backward.assign(2 * offset + 1, -1);
+    int64_t* v1 = this->forward.data();
+    int64_t* v2 = this->backward.data();
+    v1[offset + 1] = 0;
+    v2[offset + 1] = 0;
+
+    // NOTE: diagonals that ran off the edit graph are skipped from then on
+    int64_t k1_start = 0, k1_end = 0, k2_start = 0, k2_end = 0;
+
+    // NOTE: furthest forward point, the split when max_cost runs out
+    int64_t best_x = 0, best_y = 0;
+
+    for (int64_t d=0; d < max_d; d++) {
+        for (int64_t k1 = -d + k1_start; k1 <= d - k1_end; k1 += 2) {
+            int64_t x1;
+            if (k1 == -d || (k1 != d && v1[offset + k1 - 1] < v1[offset + k1 + 1])) {
+                x1 = v1[offset + k1 + 1];
+            }
+            else {
+                x1 = v1[offset + k1 - 1] + 1;
+            }
+            int64_t y1 = x1 - k1;
+            while (x1 < n && y1 < m && a[x1] == b[y1]) {
+                x1++;
+                y1++;
+            }
+            v1[offset + k1] = x1;
+
+            if (x1 > n) {
+                k1_end += 2;
+            }
+            else if (y1 > m) {
+                k1_start += 2;
+            }
+            else if (x1 + y1 > best_x + best_y) {
+                best_x = x1;
+                best_y = y1;
+            }
+
+            if (x1 <= n && y1 <= m && odd) {
+                int64_t k2 = delta - k1;
+                if (k2 >= -max_d - 1 && k2 <= max_d + 1 && v2[offset + k2] != -1 && x1 >= n - v2[offset + k2]) {
+                    x = x1;
+                    y = y1;
+                    return true;
+                }
+            }
+        }
+
+        for (int64_t k2 = -d + k2_start; k2 <= d - k2_end; k2 += 2) {
+            int64_t x2;
+            if (k2 == -d || (k2 != d && v2[offset + k2 - 1] < v2[offset + k2 + 1])) {
+                x2 = v2[offset + k2 + 1];
+            }
+            else {
+                x2 = v2[offset + k2 - 1] + 1;
+            }
+            int64_t y2 = x2 - k2;
+            while (x2 < n && y2 < m && a[n - x2 - 1] == b[m - y2 - 1]) {
+                x2++;
+                y2++;
+            }
+            v2[offset + k2] = x2;
+
+            if (x2 > n) {
+                k2_end += 2;
+            }
+            else if (y2 > m) {
+                k2_start += 2;
+            }
+            else if (!odd) {
+                int64_t k1 = delta - k2;
+                if (k1 >= -max_d - 1 && k1 <= max_d + 1 && v1[offset + k1] != -1) {
+                    int64_t x1 = v1[offset + k1];
+                    if (x1 >= n - x2) {
+                        x = x1;
+                        y = x1 - k1;
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    if (best_x + best_y == 0 || (best_x == n && best_y == m)) {
+        return false;
+    }
+    // NOTE: too expensive to find the middle snake, splitting after the
+    // longest forward path still gives a valid (if not minimal) script
+    x = best_x;
+    y = best_y;
+    return true;
+}
+
+/**
+ *  @brief Adds the edits turning a[a_begin, a_end) into b[b_begin, b_end).
+**/
+void TokenDiff::diff(uint32_t a_begin, uint32_t a_end, uint32_t b_begin, uint32_t b_end) {
+    // NOTE: common prefix and suffix, usually most of both inputs
+    while (a_begin < a_end && b_begin < b_end && this->a[a_begin] == this->b[b_begin]) {
+        a_begin++;
+        b_begin++;
+    }
+    while (a_begin < a_end && b_begin < b_end && this->a[a_end - 1] == this->b[b_end - 1]) {
+        a_end--;
+        b_end--;
+    }
+
+    if (a_begin == a_end || b_begin == b_end) {
+        if (a_begin != a_end || b_begin != b_end) {
+            this->add(a_begin, a_end, b_begin, b_end);
+        }
+        return;
+    }
+
+    uint32_t x, y;
+    if (!this->bisect(a_begin, a_end, b_begin, b_end, x, y)) {
+        this->add(a_begin, a_end, b_begin, b_end);
+        return;
+    }
+
+    this->diff(a_begin, a_begin + x, b_begin, b_begin + y);
+    this->diff(a_begin + x, a_end, b_begin + y, b_end);
+}
+
+/**
+ *  @brief Diffs two Token streams by fingerprint, see FingerprintSink.
+ *  @returns The edits turning the old stream into the new one, in order,
+ *  empty if they are equal.
+**/
+std::vector<TokenEdit> diff_tokens(
+    const std::vector<uint64_t>& old_fingerprints,
+    const std::vector<uint64_t>& new_fingerprints,
+    const TokenDiffOptions& options
+) {
+    TokenDiff diff(old_fingerprints.data(), new_fingerprints.data(), std::max<size_t>(1, options.max_cost));
+    diff.diff(0, old_fingerprints.size(), 0, new_fingerprints.size());
+    return diff.get_edits();
+}
+
+/**
+ *  @brief diff_tokens for already built Tokens.
+**/
+std::vector<TokenEdit> diff_tokens(
+    const std::vector<Token>& old_tokens,
+    const std::vector<Token>& new_tokens,
+    const TokenDiffOptions& options
+) {
+    std::vector<uint64_t> old_fingerprints, new_fingerprints;
+    old_fingerprints.reserve(old_tokens.size());
+    new_fingerprints.reserve(new_tokens.size());
+    for (const Token& t : old_tokens) {
+        old_fingerprints.push_back(token_fingerprint(t.kind, t.text()));
+    }
+    for (const Token& t : new_tokens) {
+        new_fingerprints.push_back(token_fingerprint(t.kind, t.text()));
+    }
+    return diff_tokens(old_fingerprints, new_fingerprints, options);
+}
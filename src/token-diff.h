@@ -0,0 +1,41 @@
+#ifndef TOKEN_DIFF_H
+#define TOKEN_DIFF_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "token.h"
+#include "structure-index.h"
+
+/**
+ *  @brief One change between two Token streams: old_tokens in the old stream
+ *  were replaced by new_tokens in the new one. An insertion has an empty
+ *  old_tokens (begin == end, where it was inserted), a deletion an empty
+ *  new_tokens.
+**/
+struct TokenEdit {
+    TokenRange old_tokens;
+    TokenRange new_tokens;
+};
+
+struct TokenDiffOptions {
+    // NOTE: upper bound on the edit distance searched per split, past it the
+    // range is split after the longest matching path found so far and the
+    // script may not be minimal. Keeps unrelated inputs from costing O(N * D).
+    size_t max_cost = 64;
+};
+
+std::vector<TokenEdit> diff_tokens(
+    const std::vector<uint64_t>& old_fingerprints,
+    const std::vector<uint64_t>& new_fingerprints,
+    const TokenDiffOptions& options = TokenDiffOptions()
+);
+
+std::vector<TokenEdit> diff_tokens(
+    const std::vector<Token>& old_tokens,
+    const std::vector<Token>& new_tokens,
+    const TokenDiffOptions& options = TokenDiffOptions()
+);
+
+#endif
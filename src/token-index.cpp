@@ -0,0 +1,707 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "token.h"
+#include "token-sink.h"
+#include "regex-tokenizer.h"
+#include "token-index.h"
+
+// NOTE: the index is written and mapped in native byte order, little endian
+// on every platform this builds on. Every table starts 8 byte aligned.
+
+struct TokenIndex::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t file_count;
+    uint64_t trigram_count;
+    uint64_t files_offset;     // NOTE: FileEntry[file_count]
+    uint64_t trigrams_offset;  // NOTE: TrigramEntry[trigram_count], sorted by key
+    uint64_t size;             // NOTE: of the whole index, catches truncated files
+};
+
+struct TokenIndex::FileEntry {
+    uint64_t name_offset;
+    uint64_t data_offset;   // NOTE: uint64_t fingerprints[token_count], then uint8_t kinds[token_count]
+    uint64_t lines_offset;  // NOTE: uint32_t line_starts[line_count], first Token of every line
+    uint32_t name_length;
+    uint32_t token_count;
+    uint32_t line_count;
+    uint32_t padding;
+};
+
+struct TokenIndex::TrigramEntry {
+    uint64_t key;
+    uint64_t postings_offset;  // NOTE: count varints, each the delta to the previous file << 32 | token
+    uint64_t count;            // NOTE: a kind only trigram like NAME OP NAME is in most files
+    uint64_t bytes;
+};
+
+static const char INDEX_MAGIC[8] = {'R', 'T', 'O', 'K', 'I', 'D', 'X', '\0'};
+// NOTE: 2 widened TrigramEntry::count and bytes to 64 bits
+static const uint32_t INDEX_VERSION = 2;
+
+// NOTE: murmur3 finalizer, every input bit affects every output bit
+static uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// NOTE: the low bit keeps value and kind trigrams apart
+static uint64_t value_trigram(uint64_t a, uint64_t b, uint64_t c) {
+    return mix(mix(mix(a) ^ b) ^ c) & ~1ull;
+}
+
+static uint64_t kind_trigram(uint8_t a, uint8_t b, uint8_t c) {
+    return mix(0x9E3779B97F4A7C15ull + ((uint64_t)a | (uint64_t)b << 8 | (uint64_t)c << 16)) | 1ull;
+}
+
+static void write_varint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += (char)(value | 0x80);
+        value >>= 7;
+    }
+    out += (char)value;
+}
+
+/**
+ *  @brief Decodes one posting list, see TokenIndex::TrigramEntry.
+**/
+class PostingReader {
+    private:
+        const uint8_t* next_byte;
+        const uint8_t* end;
+        uint64_t left;
+        uint64_t value;
+
+    public:
+        PostingReader(const char* data, uint64_t bytes, uint64_t count)
+            : next_byte((const uint8_t*)data), end((const uint8_t*)data + bytes), left(count), value(0) {}
+
+        bool next(uint64_t& posting) {
+            // NOTE: every posting takes at least one byte, a count past the
+            // bytes is a corrupt index
+            if (this->left == 0 || this->next_byte >= this->end) {
+                return false;
+            }
+            uint64_t delta = 0;
+            for (int shift=0; this->next_byte < this->end && shift < 64; shift += 7) {
+                uint8_t byte = *this->next_byte++;
+                delta |= (uint64_t)(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0) {
+                    break;
+                }
+            }
+            this->value += delta;
+            this->left--;
+            posting = this->value;
+            return true;
+        }
+};
+
+/**
+ *  @brief Turns a query like "NAME ( NAME . NAME (" into QueryTokens by
+ *  tokenizing it. A NAME spelled like a TokenKind (NAME, NUMBER, STRING, OP)
+ *  matches any Token of that kind, everything else matches exactly. Line
+ *  structure (NEWLINE, NL, INDENT, DEDENT) and comments are left out.
+ *  @param text the query, a single line.
+ *  @throws std::runtime_error if the query doesn't tokenize.
+**/
+std::vector<QueryToken> parse_token_query(const std::string& text) {
+    // NOTE: a query is a fragment, it can close brackets it never opened.
+    // Opening one for every closing bracket first keeps the Tokenizer's
+    // bracket level from going negative, unclosed ones are fine. The Tokenizer
+    // doesn't accept trailing spaces.
+    size_t closing = std::count_if(text.begin(), text.end(), [](char c) {
+        return c == ')' || c == ']' || c == '}';
+    });
+    std::string line = std::string(closing, '(') + text.substr(0, text.find_last_not_of(" ") + 1);
+    Tokenizer tokenizer({line});
+    std::vector<QueryToken> query;
+
+    for (int i=0; i < tokenizer.size(); i++) {
+        Token token = tokenizer.at(i);
+        if (closing > 0 && token.kind == TokenKind::OP && token.value == "(") {
+            closing--;
+            continue;
+        }
+        switch (token.kind) {
+            case TokenKind::ENCODING:
+            case TokenKind::COMMENT:
+            case TokenKind::NL:
+            case TokenKind::NEWLINE:
+            case TokenKind::INDENT:
+            case TokenKind::DEDENT:
+            case TokenKind::ENDMARKER:
+                continue;
+            default:
+                break;
+        }
+
+        TokenKind any_of = token.kind == TokenKind::NAME ? token_kind_from_string(token.value) : TokenKind::UNKNOWN;
+        if (any_of == TokenKind::NAME || any_of == TokenKind::NUMBER || any_of == TokenKind::STRING || any_of == TokenKind::OP) {
+            query.push_back({any_of, true, 0});
+        }
+        else {
+            query.push_back({token.kind, false, token_fingerprint(token.kind, token.text())});
+        }
+    }
+
+    return query;
+}
+
+/**
+ *  @brief Creates a temporary file, deleted once it is closed.
+ *  @throws std::runtime_error if it can't be created.
+**/
+static std::FILE* open_temporary_file() {
+    std::FILE* file = std::tmpfile();
+    if (file == nullptr) {
+        throw std::runtime_error(std::string("could not create a temporary file for the token index: ") + std::strerror(errno));
+    }
+    return file;
+}
+
+/**
+ *  @throws std::runtime_error if size bytes can't be written to file.
+**/
+static void write_temporary(std::FILE* file, const void* bytes, size_t size) {
+    if (size > 0 && std::fwrite(bytes, 1, size, file) != size) {
+        throw std::runtime_error(std::string("could not write a temporary file for the token index: ") + std::strerror(errno));
+    }
+}
+
+/**
+ *  @brief Reads size bytes at offset of a temporary file, after std::fflush.
+ *  @throws std::runtime_error if they can't be read.
+**/
+static void read_temporary(std::FILE* file, uint64_t offset, void* bytes, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t count = pread(fileno(file), (char*)bytes + done, size - done, offset + done);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            throw std::runtime_error("could not read a temporary file of the token index");
+        }
+        done += count;
+    }
+}
+
+/**
+ *  @brief Reads one sorted run of TokenIndexBuilder postings back in blocks.
+**/
+template <class Posting>
+class RunReader {
+    private:
+        std::FILE* file;
+        uint64_t next_posting;  // NOTE: in Postings from the start of the file
+        uint64_t end;
+        std::vector<Posting> block;
+        size_t pos;
+
+    public:
+        RunReader(std::FILE* file, uint64_t begin, uint64_t end)
+            : file(file), next_posting(begin), end(end), pos(0) {}
+
+        /**
+         *  @returns The next posting of the run, nullptr once it is done.
+        **/
+        const Posting* peek() {
+            if (this->pos == this->block.size()) {
+                if (this->next_posting == this->end) {
+                    return nullptr;
+                }
+                size_t count = std::min<uint64_t>(4096, this->end - this->next_posting);
+                this->block.resize(count);
+                read_temporary(this->file, this->next_posting * sizeof(Posting), this->block.data(), count * sizeof(Posting));
+                this->next_posting += count;
+                this->pos = 0;
+            }
+            return &this->block[this->pos];
+        }
+
+        void pop() {
+            this->pos++;
+        }
+};
+
+/**
+ *  @brief TokenIndexBuilder constructor.
+ *  @param run_postings postings kept in memory before they are sorted and
+ *  written out as a run, 16 bytes each.
+ *  @throws std::runtime_error if the temporary files can't be created.
+**/
+TokenIndexBuilder::TokenIndexBuilder(size_t run_postings)
+    : data(nullptr), data_size(0), runs(nullptr), run_postings(std::max<size_t>(1, run_postings)) {
+    this->data = open_temporary_file();
+    try {
+        this->runs = open_temporary_file();
+    }
+    catch (...) {
+        std::fclose(this->data);
+        throw;
+    }
+}
+
+/**
+ *  @brief TokenIndexBuilder destructor, removes the temporary files.
+**/
+TokenIndexBuilder::~TokenIndexBuilder() {
+    std::fclose(this->data);
+    std::fclose(this->runs);
+}
+
+/**
+ *  @brief Appends bytes to this->data, 8 byte aligned like every table of the index.
+**/
+void TokenIndexBuilder::put_data(const void* bytes, size_t size) {
+    static const char zeros[8] = {};
+    write_temporary(this->data, bytes, size);
+    write_temporary(this->data, zeros, (8 - size % 8) % 8);
+    this->data_size += size + (8 - size % 8) % 8;
+}
+
+/**
+ *  @brief Sorts this->postings and moves them to this->runs as one run.
+**/
+void TokenIndexBuilder::write_run() {
+    if (this->postings.empty()) {
+        return;
+    }
+    std::sort(this->postings.begin(), this->postings.end(), [](const Posting& a, const Posting& b) {
+        return a.key < b.key || (a.key == b.key && a.location < b.location);
+    });
+    write_temporary(this->runs, this->postings.data(), this->postings.size() * sizeof(Posting));
+    this->run_ends.push_back((this->run_ends.empty() ? 0 : this->run_ends.back()) + this->postings.size());
+    this->postings.clear();
+}
+
+/**
+ *  @brief Adds the Tokens of a file, tokenized with a FingerprintSink.
+ *  @returns The file's id.
+ *  @throws std::runtime_error if the file is too big or can't be stored.
+**/
+uint32_t TokenIndexBuilder::add_file(const std::string& name, const FingerprintSink& tokens) {
+    if (tokens.fingerprints.size() > UINT32_MAX || this->files.size() >= UINT32_MAX) {
+        throw std::runtime_error("\"" + name + "\" is too big for a token index");
+    }
+    uint32_t id = this->files.size();
+
+    std::vector<uint32_t> line_starts;
+    for (size_t i=0; i < tokens.lines.size(); i++) {
+        while ((int)line_starts.size() < tokens.lines[i]) {
+            line_starts.push_back(i);
+        }
+    }
+
+    File file;
+    file.name_offset = this->data_size;
+    file.name_length = name.size();
+    this->put_data(name.data(), name.size());
+    file.data_offset = this->data_size;
+    file.token_count = tokens.fingerprints.size();
+    write_temporary(this->data, tokens.fingerprints.data(), tokens.fingerprints.size() * sizeof(uint64_t));
+    this->data_size += tokens.fingerprints.size() * sizeof(uint64_t);
+    this->put_data(tokens.kinds.data(), tokens.kinds.size());
+    file.lines_offset = this->data_size;
+    file.line_count = line_starts.size();
+    this->put_data(line_starts.data(), line_starts.size() * sizeof(uint32_t));
+
+    const std::vector<uint64_t>& fingerprints = tokens.fingerprints;
+    const std::vector<uint8_t>& kinds = tokens.kinds;
+    for (size_t i=0; i + 2 < fingerprints.size(); i++) {
+        uint64_t location = (uint64_t)id << 32 | i;
+        this->postings.push_back({value_trigram(fingerprints[i], fingerprints[i+1], fingerprints[i+2]), location});
+        this->postings.push_back({kind_trigram(kinds[i], kinds[i+1], kinds[i+2]), location});
+        if (this->postings.size() >= this->run_postings) {
+            this->write_run();
+        }
+    }
+
+    this->files.push_back(file);
+    return id;
+}
+
+size_t TokenIndexBuilder::size() const {
+    return this->files.size();
+}
+
+/**
+ *  @brief Writes the index, see TokenIndex for the layout. Merges the sorted
+ *  runs of postings, holding one block of every run in memory.
+ *  @throws std::runtime_error if fname can't be written.
+**/
+void TokenIndexBuilder::write(const std::string& fname) {
+    this->write_run();
+    std::FILE* trigrams = open_temporary_file();
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> trigrams_owner(trigrams, std::fclose);
+    if (std::fflush(this->data) != 0 || std::fflush(this->runs) != 0) {
+        throw std::runtime_error("could not write a temporary file for the token index");
+    }
+
+    std::ofstream out(fname, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("could not write \"" + fname + "\"");
+    }
+
+    uint64_t offset = 0;
+    auto put = [&](const void* bytes, size_t size) {
+        out.write((const char*)bytes, size);
+        offset += size;
+    };
+    auto align = [&]() {
+        static const char zeros[8] = {};
+        put(zeros, (8 - offset % 8) % 8);
+    };
+    // NOTE: copies a temporary file into the index
+    std::vector<char> block(1 << 16);
+    auto copy = [&](std::FILE* file, uint64_t size) {
+        for (uint64_t done=0; done < size;) {
+            size_t count = std::min<uint64_t>(block.size(), size - done);
+            read_temporary(file, done, block.data(), count);
+            put(block.data(), count);
+            done += count;
+        }
+    };
+
+    TokenIndex::Header header{};
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.file_count = this->files.size();
+    put(&header, sizeof(header));  // NOTE: rewritten at the end with the offsets
+
+    // NOTE: this->data is already in the index layout, 8 byte aligned from here
+    static_assert(sizeof(TokenIndex::Header) % 8 == 0, "the header keeps the tables aligned");
+    uint64_t data_base = offset;
+    copy(this->data, this->data_size);
+
+    // NOTE: k-way merge of the runs, the smallest (key, location) first
+    std::vector<RunReader<Posting>> readers;
+    for (size_t i=0; i < this->run_ends.size(); i++) {
+        readers.emplace_back(this->runs, i == 0 ? 0 : this->run_ends[i-1], this->run_ends[i]);
+    }
+    auto later = [&](size_t a, size_t b) {
+        const Posting* x = readers[a].peek();
+        const Posting* y = readers[b].peek();
+        return x->key > y->key || (x->key == y->key && x->location > y->location);
+    };
+    std::vector<size_t> heap;
+    for (size_t i=0; i < readers.size(); i++) {
+        if (readers[i].peek() != nullptr) {
+            heap.push_back(i);
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(), later);
+
+    uint64_t trigram_count = 0;
+    TokenIndex::TrigramEntry entry{0, 0, 0, 0};
+    uint64_t previous = 0;
+    std::string encoded;
+    auto finish_trigram = [&]() {
+        put(encoded.data(), encoded.size());
+        entry.bytes += encoded.size();
+        encoded.clear();
+        write_temporary(trigrams, &entry, sizeof(entry));
+        trigram_count++;
+    };
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        RunReader<Posting>& reader = readers[heap.back()];
+        Posting posting = *reader.peek();
+        reader.pop();
+        if (reader.peek() != nullptr) {
+            std::push_heap(heap.begin(), heap.end(), later);
+        }
+        else {
+            heap.pop_back();
+        }
+
+        if (entry.count == 0 || posting.key != entry.key) {
+            if (entry.count > 0) {
+                finish_trigram();
+            }
+            entry = TokenIndex::TrigramEntry{posting.key, offset, 0, 0};
+            previous = 0;
+        }
+        write_varint(encoded, posting.location - previous);
+        previous = posting.location;
+        entry.count++;
+        // NOTE: a common trigram's postings don't have to fit in memory either
+        if (encoded.size() >= block.size()) {
+            put(encoded.data(), encoded.size());
+            entry.bytes += encoded.size();
+            encoded.clear();
+        }
+    }
+    if (entry.count > 0) {
+        finish_trigram();
+    }
+    align();
+
+    header.files_offset = offset;
+    for (const File& file : this->files) {
+        TokenIndex::FileEntry file_entry{};
+        file_entry.name_offset = data_base + file.name_offset;
+        file_entry.data_offset = data_base + file.data_offset;
+        file_entry.lines_offset = data_base + file.lines_offset;
+        file_entry.name_length = file.name_length;
+        file_entry.token_count = file.token_count;
+        file_entry.line_count = file.line_count;
+        put(&file_entry, sizeof(file_entry));
+    }
+
+    header.trigrams_offset = offset;
+    header.trigram_count = trigram_count;
+    if (std::fflush(trigrams) != 0) {
+        throw std::runtime_error("could not write a temporary file for the token index");
+    }
+    copy(trigrams, trigram_count * sizeof(TokenIndex::TrigramEntry));
+    header.size = offset;
+
+    out.seekp(0);
+    out.write((const char*)&header, sizeof(header));
+    out.close();
+    if (out.fail()) {
+        throw std::runtime_error("could not write \"" + fname + "\"");
+    }
+}
+
+/**
+ *  @brief Maps an index written by TokenIndexBuilder::write.
+ *  @throws std::runtime_error if fname can't be read or isn't an index.
+**/
+TokenIndex::TokenIndex(const std::string& fname) : data(nullptr), size(0), header(nullptr), files(nullptr), trigrams(nullptr) {
+    int fd = open(fname.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("could not open \"" + fname + "\": " + std::strerror(errno));
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(Header)) {
+        close(fd);
+        throw std::runtime_error("\"" + fname + "\" is not a token index");
+    }
+
+    this->size = info.st_size;
+    void* mapping = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("could not map \"" + fname + "\": " + std::strerror(errno));
+    }
+    this->data = (const char*)mapping;
+    this->header = (const Header*)this->data;
+
+    const Header& h = *this->header;
+    bool valid =
+        std::memcmp(h.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 &&
+        h.version == INDEX_VERSION &&
+        h.size == this->size &&
+        h.files_offset % 8 == 0 &&
+        h.files_offset <= this->size &&
+        h.file_count <= (this->size - h.files_offset) / sizeof(FileEntry) &&
+        h.trigrams_offset % 8 == 0 &&
+        h.trigrams_offset <= this->size &&
+        h.trigram_count <= (this->size - h.trigrams_offset) / sizeof(TrigramEntry);
+
+    // NOTE: file_name, verify and line_of trust the file table from here on
+    const FileEntry* entries = (const FileEntry*)(this->data + h.files_offset);
+    for (uint32_t i=0; valid && i < h.file_count; i++) {
+        valid = this->fits(entries[i].name_offset, entries[i].name_length, 1, 1) &&
+            this->fits(entries[i].data_offset, entries[i].token_count, sizeof(uint64_t) + sizeof(uint8_t), alignof(uint64_t)) &&
+            this->fits(entries[i].lines_offset, entries[i].line_count, sizeof(uint32_t), alignof(uint32_t));
+    }
+
+    if (!valid) {
+        munmap(mapping, this->size);
+        throw std::runtime_error("\"" + fname + "\" is not a token index (or a different version)");
+    }
+
+    this->files = entries;
+    this->trigrams = (const TrigramEntry*)(this->data + h.trigrams_offset);
+}
+
+/**
+ *  @returns Whether count items of item_size bytes at offset are inside the
+ *  mapping and aligned to alignment.
+**/
+bool TokenIndex::fits(uint64_t offset, uint64_t count, uint64_t item_size, uint64_t alignment) const {
+    return offset % alignment == 0 && offset <= this->size && count <= (this->size - offset) / item_size;
+}
+
+TokenIndex::~TokenIndex() {
+    munmap((void*)this->data, this->size);
+}
+
+size_t TokenIndex::file_count() const {
+    return this->header->file_count;
+}
+
+std::string_view TokenIndex::file_name(uint32_t file) const {
+    const FileEntry& entry = this->files[file];
+    return std::string_view(this->data + entry.name_offset, entry.name_length);
+}
+
+size_t TokenIndex::trigram_count() const {
+    return this->header->trigram_count;
+}
+
+/**
+ *  @returns The entry of key, nullptr if no trigram has it.
+**/
+const TokenIndex::TrigramEntry* TokenIndex::find_trigram(uint64_t key) const {
+    const TrigramEntry* end = this->trigrams + this->header->trigram_count;
+    const TrigramEntry* entry = std::lower_bound(this->trigrams, end, key, [](const TrigramEntry& e, uint64_t k) {
+        return e.key < k;
+    });
+    if (entry == end || entry->key != key || !this->fits(entry->postings_offset, entry->bytes, 1, 1)) {
+        return nullptr;
+    }
+    return entry;
+}
+
+/**
+ *  @brief Checks the Tokens of file from token on against query.
+**/
+bool TokenIndex::verify(uint32_t file, uint32_t token, const std::vector<QueryToken>& query) const {
+    const FileEntry& entry = this->files[file];
+    if ((uint64_t)token + query.size() > entry.token_count) {
+        return false;
+    }
+
+    const uint64_t* fingerprints = (const uint64_t*)(this->data + entry.data_offset);
+    const uint8_t* kinds = (const uint8_t*)(fingerprints + entry.token_count);
+    for (size_t i=0; i < query.size(); i++) {
+        if (kinds[token + i] != (uint8_t)query[i].kind) {
+            return false;
+        }
+        if (!query[i].any_value && fingerprints[token + i] != query[i].fingerprint) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ *  @returns The line the Token starts on.
+**/
+int TokenIndex::line_of(uint32_t file, uint32_t token) const {
+    const FileEntry& entry = this->files[file];
+    const uint32_t* line_starts = (const uint32_t*)(this->data + entry.lines_offset);
+    return std::upper_bound(line_starts, line_starts + entry.line_count, token) - line_starts;
+}
+
+/**
+ *  @brief Finds every place query occurs in the corpus.
+ *  @param query see parse_token_query.
+ *  @param max_matches stop after this many matches.
+ *  @returns The matches sorted by file and Token.
+**/
+std::vector<TokenIndexMatch> TokenIndex::find(const std::vector<QueryToken>& query, size_t max_matches) const {
+    std::vector<TokenIndexMatch> matches;
+    if (query.empty()) {
+        return matches;
+    }
+
+    if (query.size() < 3) {
+        // NOTE: no trigram to look up, check every position
+        for (uint32_t file=0; file < this->header->file_count; file++) {
+            for (uint32_t token=0; token < this->files[file].token_count && matches.size() < max_matches; token++) {
+                if (this->verify(file, token, query)) {
+                    matches.push_back({file, token, this->line_of(file, token)});
+                }
+            }
+        }
+        return matches;
+    }
+
+    struct Window {
+        uint32_t shift;  // NOTE: position of the trigram in the query
+        const TrigramEntry* entry;
+    };
+    std::vector<Window> windows;
+    for (size_t i=0; i + 2 < query.size(); i++) {
+        const QueryToken* q = &query[i];
+        bool exact = !q[0].any_value && !q[1].any_value && !q[2].any_value;
+        uint64_t key = exact
+            ? value_trigram(q[0].fingerprint, q[1].fingerprint, q[2].fingerprint)
+            : kind_trigram((uint8_t)q[0].kind, (uint8_t)q[1].kind, (uint8_t)q[2].kind);
+
+        const TrigramEntry* entry = this->find_trigram(key);
+        if (entry == nullptr) {
+            return matches;  // NOTE: a trigram that occurs nowhere, nothing can match
+        }
+        windows.push_back({(uint32_t)i, entry});
+    }
+    std::sort(windows.begin(), windows.end(), [](const Window& a, const Window& b) {
+        return a.entry->count < b.entry->count;
+    });
+
+    // NOTE: candidates are file << 32 | first Token of the match, sorted. A
+    // posting at token t of the trigram at shift s is a candidate at t - s.
+    std::vector<uint64_t> candidates;
+    {
+        const Window& rarest = windows[0];
+        PostingReader reader(this->data + rarest.entry->postings_offset, rarest.entry->bytes, rarest.entry->count);
+        for (uint64_t posting; reader.next(posting);) {
+            if ((uint32_t)posting >= rarest.shift) {
+                candidates.push_back(posting - rarest.shift);
+            }
+        }
+    }
+
+    std::vector<uint64_t> kept;
+    for (size_t w=1; w < windows.size() && !candidates.empty(); w++) {
+        const Window& window = windows[w];
+        // NOTE: past this, verifying the candidates is cheaper than decoding the list
+        if (window.entry->count > 16 * candidates.size()) {
+            break;
+        }
+
+        PostingReader reader(this->data + window.entry->postings_offset, window.entry->bytes, window.entry->count);
+        kept.clear();
+        size_t c = 0;
+        for (uint64_t posting; reader.next(posting) && c < candidates.size();) {
+            if ((uint32_t)posting < window.shift) {
+                continue;
+            }
+            uint64_t start = posting - window.shift;
+            while (c < candidates.size() && candidates[c] < start) {
+                c++;
+            }
+            if (c < candidates.size() && candidates[c] == start) {
+                kept.push_back(start);
+                c++;
+            }
+        }
+        std::swap(candidates, kept);
+    }
+
+    for (uint64_t candidate : candidates) {
+        uint32_t file = candidate >> 32;
+        uint32_t token = (uint32_t)candidate;
+        if (file < this->header->file_count && this->verify(file, token, query)) {
+            matches.push_back({file, token, this->line_of(file, token)});
+            if (matches.size() >= max_matches) {
+                break;
+            }
+        }
+    }
+
+    return matches;
+}
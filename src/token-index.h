@@ -0,0 +1,127 @@
+#ifndef TOKEN_INDEX_H
+#define TOKEN_INDEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include "token.h"
+#include "token-sink.h"
+
+/**
+ *  @brief One Token of a query, either an exact Token (kind and value) or
+ *  any Token of a kind.
+**/
+struct QueryToken {
+    TokenKind kind;
+    bool any_value;        // NOTE: matches every Token of kind
+    uint64_t fingerprint;  // NOTE: token_fingerprint, unused if any_value
+};
+
+struct TokenIndexMatch {
+    uint32_t file;   // NOTE: see TokenIndex::file_name
+    uint32_t token;  // NOTE: index of the first matched Token, like Tokenizer::at()
+    int line;
+};
+
+std::vector<QueryToken> parse_token_query(const std::string& text);
+
+/**
+ *  @brief Collects the Tokens of a corpus and writes them as a TokenIndex.
+ *  Files get ids 0, 1, 2, ... in the order they are added.
+ *
+ *  Only a small entry per file stays in memory. A file's Tokens go straight
+ *  to a temporary file in their final layout, and its trigram postings are
+ *  sorted in runs of run_postings, each written to a second temporary file
+ *  once full. write() merges the runs into the index.
+**/
+class TokenIndexBuilder {
+    private:
+        struct File {
+            uint64_t name_offset;  // NOTE: offsets into this->data
+            uint64_t data_offset;
+            uint64_t lines_offset;
+            uint32_t name_length;
+            uint32_t token_count;
+            uint32_t line_count;
+        };
+        struct Posting {
+            uint64_t key;       // NOTE: trigram key
+            uint64_t location;  // NOTE: file << 32 | token
+        };
+
+        std::vector<File> files;
+        std::FILE* data;
+        uint64_t data_size;
+        std::FILE* runs;
+        std::vector<uint64_t> run_ends;  // NOTE: in Postings, every run is sorted
+        std::vector<Posting> postings;   // NOTE: the run being collected
+        size_t run_postings;
+
+        void put_data(const void* bytes, size_t size);
+        void write_run();
+
+    public:
+        explicit TokenIndexBuilder(size_t run_postings = 1 << 22);
+        ~TokenIndexBuilder();
+
+        // not copyable, owns the temporary files
+        TokenIndexBuilder(const TokenIndexBuilder&) = delete;
+        void operator=(const TokenIndexBuilder&) = delete;
+
+        uint32_t add_file(const std::string& name, const FingerprintSink& tokens);
+        size_t size() const;
+        void write(const std::string& fname);
+};
+
+/**
+ *  @brief Inverted index from Token trigrams to where they occur in a
+ *  corpus, read through mmap so opening it costs nothing up front.
+ *
+ *  Every 3 consecutive Tokens of every file are indexed twice, by their
+ *  kinds and values (token_fingerprint) and by their kinds only, so a query
+ *  can mix exact Tokens with any-of-a-kind ones. The postings of a trigram
+ *  are (file, Token offset) pairs, sorted, delta + varint (LEB128) coded.
+ *  find() intersects the postings of the query's trigrams, rarest first,
+ *  then verifies every candidate against the stored fingerprints and kinds.
+ *  Queries shorter than 3 Tokens scan those instead.
+ *
+ *  File layout, native byte order, see token-index.cpp:
+ *      header, per file name + fingerprints + kinds + line starts,
+ *      postings, file table, trigram table (sorted by key)
+**/
+class TokenIndex {
+    private:
+        struct Header;
+        struct FileEntry;
+        struct TrigramEntry;
+        friend class TokenIndexBuilder;
+
+        const char* data;
+        size_t size;
+        const Header* header;
+        const FileEntry* files;
+        const TrigramEntry* trigrams;
+
+        bool fits(uint64_t offset, uint64_t count, uint64_t item_size, uint64_t alignment) const;
+        const TrigramEntry* find_trigram(uint64_t key) const;
+        bool verify(uint32_t file, uint32_t token, const std::vector<QueryToken>& query) const;
+        int line_of(uint32_t file, uint32_t token) const;
+
+    public:
+        explicit TokenIndex(const std::string& fname);
+        ~TokenIndex();
+
+        // not copyable, owns the mapping
+        TokenIndex(const TokenIndex&) = delete;
+        void operator=(const TokenIndex&) = delete;
+
+        std::vector<TokenIndexMatch> find(const std::vector<QueryToken>& query, size_t max_matches = SIZE_MAX) const;
+        size_t file_count() const;
+        std::string_view file_name(uint32_t file) const;
+        size_t trigram_count() const;
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include "token.h"
+#include "trace.h"
+#include "token-sink.h"
+#include "regex-tokenizer.h"
+#include "token-pipeline.h"
+
+/**
+ *  @brief TokenPipeline constructor. Starts tokenizing input on the producer thread.
+ *  @param input input to tokenize.
+ *  @param batch_size Tokens per batch, bigger batches mean less synchronization
+ *  but a later start for the consumer.
+ *  @param queue_batches max batches in flight before the producer waits.
+ *  @param options optional tokenizer behavior, see TokenizerOptions.
+**/
+TokenPipeline::TokenPipeline(
+    std::vector<std::string> input,
+    size_t batch_size,
+    size_t queue_batches,
+    const TokenizerOptions& options
+) : queue(queue_batches), done(false), stopped(false), status(TokenizeStatus::COMPLETE) {
+    if (batch_size == 0) {
+        throw std::runtime_error("TokenPipeline batch_size must be at least 1");
+    }
+    this->producer = std::thread(
+        &TokenPipeline::produce,
+        this,
+        std::move(input),
+        batch_size,
+        options
+    );
+}
+
+/**
+ *  @brief TokenPipeline destructor. Stops the producer if the stream wasn't consumed.
+**/
+TokenPipeline::~TokenPipeline() {
+    this->stopped.store(true, std::memory_order_release);
+    if (this->producer.joinable()) {
+        this->producer.join();
+    }
+}
+
+/**
+ *  @brief Producer thread body, tokenizes input into BatchingSink.
+**/
+void TokenPipeline::produce(std::vector<std::string> input, size_t batch_size, TokenizerOptions options) {
+    trace_set_thread_name("tokenizer");
+
+    try {
+        TraceSpan span("tokenize");
+        BasicTokenizer<BatchingSink> tokenizer(
+            std::move(input),
+            BatchingSink(&this->queue, &this->stopped, batch_size),
+            options
+        );
+        tokenizer.get_sink().flush();
+        this->status = tokenizer.get_status();
+    }
+    catch (const PipelineStopped&) {
+        // NOTE: consumer went away, nothing left to report to
+    }
+    catch (...) {
+        this->error = std::current_exception();
+    }
+
+    // NOTE: release so the consumer sees every batch, this->error and this->status
+    this->done.store(true, std::memory_order_release);
+}
+
+/**
+ *  @brief Waits for the next batch of Tokens.
+ *  @param batch replaced by the next batch.
+ *  @returns false once every batch was consumed (end of stream). If
+ *  tokenization failed the error is rethrown after the last good batch.
+**/
+bool TokenPipeline::next_batch(std::vector<Token>& batch) {
+    int spins = 0;
+
+    while (true) {
+        if (this->queue.try_pop(batch)) {
+            return true;
+        }
+        if (this->done.load(std::memory_order_acquire)) {
+            // NOTE: the producer may have pushed its last batch right before finishing
+            if (this->queue.try_pop(batch)) {
+                return true;
+            }
+            if (this->error) {
+                std::exception_ptr error = this->error;
+                this->error = nullptr;
+                std::rethrow_exception(error);
+            }
+            return false;
+        }
+        if (++spins > 64) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+/**
+ *  @brief How tokenizing ended, only valid once next_batch() returned false.
+**/
+TokenizeStatus TokenPipeline::get_status() const {
+    return this->status;
+}
@@ -0,0 +1,110 @@
+#ifndef TOKEN_PIPELINE_H
+#define TOKEN_PIPELINE_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <tuple>
+#include "token.h"
+#include "spsc-queue.h"
+#include "regex-tokenizer.h"
+
+// NOTE: thrown out of BatchingSink::push to unwind the tokenizer once the
+// consumer side of a TokenPipeline has gone away
+struct PipelineStopped {};
+
+/**
+ *  @brief Groups Tokens into batches of batch_size and publishes them to queue,
+ *  the producer side of a TokenPipeline. flush() must be called once the
+ *  tokenizer is done to publish the last, partial batch.
+**/
+struct BatchingSink {
+    static constexpr bool wants_values = true;
+
+    SpscQueue<std::vector<Token>>* queue;
+    const std::atomic<bool>* stopped;
+    size_t batch_size;
+    std::vector<Token> batch;
+
+    explicit BatchingSink(
+        SpscQueue<std::vector<Token>>* queue = nullptr,
+        const std::atomic<bool>* stopped = nullptr,
+        size_t batch_size = 256
+    ) : queue(queue), stopped(stopped), batch_size(batch_size) {
+        this->batch.reserve(batch_size);
+    }
+
+    void push(
+        TokenKind kind,
+        const std::string& value,
+        std::tuple<int, int> start,
+        std::tuple<int, int> end,
+        const TokenAttributes& attributes
+    ) {
+        this->batch.push_back(Token(kind, value, start, end, attributes));
+        if (this->batch.size() >= this->batch_size) {
+            this->flush();
+        }
+    }
+
+    void flush() {
+        if (this->batch.empty()) {
+            return;
+        }
+
+        // NOTE: backpressure, the tokenizer waits here while the consumer is behind
+        int spins = 0;
+        while (!this->queue->try_push(this->batch)) {
+            if (this->stopped->load(std::memory_order_acquire)) {
+                throw PipelineStopped();
+            }
+            if (++spins > 64) {
+                std::this_thread::yield();
+            }
+        }
+
+        this->batch = std::vector<Token>();
+        this->batch.reserve(this->batch_size);
+    }
+};
+
+/**
+ *  @brief Runs the tokenizer on its own thread and hands its Tokens to the
+ *  caller in batches, so the caller (parser, printer) can start before the
+ *  whole input is tokenized.
+ *
+ *  The producer publishes batches of batch_size Tokens through a lock-free
+ *  SpscQueue holding at most queue_batches batches, and waits while it is
+ *  full. Only the thread that created the pipeline may call next_batch().
+**/
+class TokenPipeline {
+    private:
+        SpscQueue<std::vector<Token>> queue;
+        std::atomic<bool> done;
+        std::atomic<bool> stopped;
+        std::exception_ptr error;
+        TokenizeStatus status;
+        std::thread producer;
+
+        void produce(std::vector<std::string> input, size_t batch_size, TokenizerOptions options);
+
+    public:
+        TokenPipeline(
+            std::vector<std::string> input,
+            size_t batch_size = 256,
+            size_t queue_batches = 64,
+            const TokenizerOptions& options = TokenizerOptions()
+        );
+        ~TokenPipeline();
+
+        // not copyable, the producer thread holds on to this
+        TokenPipeline(const TokenPipeline&) = delete;
+        void operator=(const TokenPipeline&) = delete;
+
+        bool next_batch(std::vector<Token>& batch);
+        TokenizeStatus get_status() const;
+};
+
+#endif
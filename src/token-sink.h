@@ -0,0 +1,171 @@
+#ifndef TOKEN_SINK_H
+#define TOKEN_SINK_H
+
+#include <string>
+#include <vector>
+#include <array>
+#include <tuple>
+#include <functional>
+#include "token.h"
+
+// NOTE: BasicTokenizer<Sink> hands every Token to Sink::push instead of
+// storing it. A sink needs:
+//     static constexpr bool wants_values;
+//     void push(TokenKind, const std::string& value, start, end, const TokenAttributes&);
+// When wants_values is false the tokenizer never copies a Token's text out
+// of its line and push gets "" for it, only the constant values of ENCODING,
+// NEWLINE and NL are passed as is. Options that need the text
+// (interner, line_cache, structure) still get it built, see
+// BasicTokenizer::value_of. Sinks are explicitly instantiated at the bottom
+// of regex-tokenizer.cpp, a new sink has to be added there as well. Sinks
+// that belong to one user live next to it, see span-sink.h (the C ABI) and
+// token-pipeline.h.
+
+/**
+ *  @brief Collects every Token, what Tokenizer uses.
+**/
+struct VectorSink {
+    static constexpr bool wants_values = true;
+
+    std::vector<Token> tokens;
+
+    void push(
+        TokenKind kind,
+        const std::string& value,
+        std::tuple<int, int> start,
+        std::tuple<int, int> end,
+        const TokenAttributes& attributes
+    ) {
+        this->tokens.push_back(Token(kind, value, start, end, attributes));
+    }
+};
+
+/**
+ *  @brief Only counts Tokens per TokenKind, never builds a Token.
+**/
+struct CountingSink {
+    static constexpr bool wants_values = false;
+
+    std::array<size_t, TOKEN_KIND_COUNT> counts{};
+    size_t total = 0;
+
+    void push(
+        TokenKind kind,
+        const std::string&,
+        std::tuple<int, int>,
+        std::tuple<int, int>,
+        const TokenAttributes&
+    ) {
+        this->counts[(int)kind]++;
+        this->total++;
+    }
+};
+
+/**
+ *  @brief Collects only the Tokens whose kind is set in mask.
+ *  e.g. FilterSink(token_kind_bit(TokenKind::NAME)) or
+ *  FilterSink(~(token_kind_bit(TokenKind::COMMENT) | token_kind_bit(TokenKind::NL)))
+**/
+struct FilterSink {
+    static constexpr bool wants_values = true;
+
+    unsigned mask;
+    std::vector<Token> tokens;
+
+    explicit FilterSink(unsigned mask = ~0u) : mask(mask) {}
+
+    void push(
+        TokenKind kind,
+        const std::string& value,
+        std::tuple<int, int> start,
+        std::tuple<int, int> end,
+        const TokenAttributes& attributes
+    ) {
+        if (this->mask & token_kind_bit(kind)) {
+            this->tokens.push_back(Token(kind, value, start, end, attributes));
+        }
+    }
+};
+
+/**
+ *  @brief Forwards every Token to a callback as soon as it is produced.
+**/
+struct CallbackSink {
+    static constexpr bool wants_values = true;
+
+    std::function<void(const Token&)> callback;
+
+    explicit CallbackSink(std::function<void(const Token&)> callback = nullptr)
+        : callback(std::move(callback)) {}
+
+    void push(
+        TokenKind kind,
+        const std::string& value,
+        std::tuple<int, int> start,
+        std::tuple<int, int> end,
+        const TokenAttributes& attributes
+    ) {
+        if (this->callback) {
+            this->callback(Token(kind, value, start, end, attributes));
+        }
+    }
+};
+
+/**
+ *  @brief Collects Tokens into chunks of chunk_size and hands every full chunk
+ *  to a callback, so only one chunk is held at a time. The last, partial chunk
+ *  is left in chunk once the tokenizer is done.
+**/
+struct ChunkSink {
+    static constexpr bool wants_values = true;
+
+    size_t chunk_size;
+    std::function<void(std::vector<Token>& chunk)> callback;
+    std::vector<Token> chunk;
+
+    explicit ChunkSink(size_t chunk_size = 4096, std::function<void(std::vector<Token>& chunk)> callback = nullptr)
+        : chunk_size(chunk_size), callback(std::move(callback)) {
+        this->chunk.reserve(chunk_size);
+    }
+
+    void push(
+        TokenKind kind,
+        const std::string& value,
+        std::tuple<int, int> start,
+        std::tuple<int, int> end,
+        const TokenAttributes& attributes
+    ) {
+        this->chunk.push_back(Token(kind, value, start, end, attributes));
+        if (this->chunk.size() >= this->chunk_size && this->callback) {
+            this->callback(this->chunk);
+            this->chunk.clear();
+        }
+    }
+};
+
+/**
+ *  @brief Keeps only a token_fingerprint, the kind and the start line of
+ *  every Token, the input of diff_tokens (see token-diff.h) and
+ *  TokenIndexBuilder (see token-index.h).
+**/
+struct FingerprintSink {
+    static constexpr bool wants_values = true;
+
+    std::vector<uint64_t> fingerprints;
+    std::vector<uint8_t> kinds;  // NOTE: TokenKind
+    std::vector<int> lines;
+
+    void push(
+        TokenKind kind,
+        const std::string& value,
+        std::tuple<int, int> start,
+        std::tuple<int, int>,
+        const TokenAttributes&
+    ) {
+        this->fingerprints.push_back(token_fingerprint(kind, value));
+        this->kinds.push_back((uint8_t)kind);
+        this->lines.push_back(std::get<0>(start));
+    }
+};
+
+#endif
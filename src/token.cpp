@@ -1,15 +1,169 @@
 #include <iostream>
 #include <string>
-#include <iomanip>
+#include <algorithm>
 #include <tuple>
+#include <charconv>
+#include <cstring>
 #include "token.h"
+#include "unicode.h"
 #include "util.h"
 
+static const std::string token_kind_names[TOKEN_KIND_COUNT] = {
+    "ENCODING",
+    "NAME",
+    "NUMBER",
+    "STRING",
+    "OP",
+    "COMMENT",
+    "NL",
+    "NEWLINE",
+    "INDENT",
+    "DEDENT",
+    "ENDMARKER",
+    "unknown"
+};
+
+/**
+ *  @brief Name of a TokenKind as printed by python -m tokenize.
+**/
+const std::string& token_kind_name(TokenKind kind) {
+    return token_kind_names[(int)kind];
+}
+
+/**
+ *  @brief Looks up the TokenKind for a type name.
+ *  @returns The matching TokenKind, or TokenKind::UNKNOWN.
+**/
+TokenKind token_kind_from_string(const std::string& type) {
+    for (int i=0; i < TOKEN_KIND_COUNT; i++) {
+        if (token_kind_names[i] == type) {
+            return (TokenKind)i;
+        }
+    }
+    return TokenKind::UNKNOWN;
+}
+
+/**
+ *  @brief 64 bit hash of a Token's kind and value, equal Tokens (operator==)
+ *  get equal fingerprints. Position isn't part of it, so a moved Token keeps
+ *  its fingerprint. FNV-1a over the value, then a finalizer so the low bits
+ *  depend on every byte.
+**/
+uint64_t token_fingerprint(TokenKind kind, std::string_view value) {
+    uint64_t hash = 14695981039346656037ull ^ (uint64_t)kind;
+    for (unsigned char c : value) {
+        hash = (hash ^ c) * 1099511628211ull;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// NOTE: python -m tokenize pads the position and the type by characters,
+// then the quoted value by code points
+const size_t POSITION_WIDTH = 20;
+const size_t TYPE_WIDTH = 15;
+const size_t VALUE_WIDTH = 15;
+// NOTE: 4 ints of up to 11 characters each plus ",-,:"
+const size_t POSITION_BOUND = 4 * 11 + 4;
+
+/**
+ *  @brief Writes "line,column-line,column:" of token to out, which has room
+ *  for POSITION_BOUND characters.
+ *  @returns The end of the written position.
+**/
+static char* format_position(const Token& token, char* out) {
+    char* end = out + POSITION_BOUND;
+    out = std::to_chars(out, end, token.line_start).ptr;
+    *out++ = ',';
+    out = std::to_chars(out, end, token.column_start).ptr;
+    *out++ = '-';
+    out = std::to_chars(out, end, token.line_end).ptr;
+    *out++ = ',';
+    out = std::to_chars(out, end, token.column_end).ptr;
+    *out++ = ':';
+    return out;
+}
+
+/**
+ *  @brief Pads the field from start to out with spaces to width characters.
+ *  @returns The end of the padded field.
+**/
+static char* pad_field(char* start, char* out, size_t width) {
+    size_t length = out - start;
+    if (length < width) {
+        std::memset(out, ' ', width - length);
+        out += width - length;
+    }
+    return out;
+}
+
+/**
+ *  @returns Buffer size format_token needs for token.
+**/
+size_t format_token_bound(const Token& token) {
+    return
+        std::max(POSITION_WIDTH, POSITION_BOUND) +
+        std::max(TYPE_WIDTH, token.type.size()) +
+        std::max(VALUE_WIDTH, token.text().size() + 2);
+}
+
+/**
+ *  @brief Formats token like operator<< (the python -m tokenize format) into
+ *  buffer, without allocating. Formatting many Tokens into one buffer and
+ *  writing it once is cheaper than streaming them one by one.
+ *  @param buffer written from the start, not NUL terminated.
+ *  @param size of buffer, at least format_token_bound(token).
+ *  @returns The formatted length, 0 (and nothing written) if size is smaller
+ *  than format_token_bound(token).
+**/
+size_t format_token(const Token& token, char* buffer, size_t size) {
+    if (size < format_token_bound(token)) {
+        return 0;
+    }
+
+    char* out = format_position(token, buffer);
+    out = pad_field(buffer, out, POSITION_WIDTH);
+
+    char* field = out;
+    std::memcpy(out, token.type.data(), token.type.size());
+    out = pad_field(field, out + token.type.size(), TYPE_WIDTH);
+
+    std::string_view text = token.text();
+    char quote_char = token.get_quotes();
+    *out++ = quote_char;
+    std::memcpy(out, text.data(), text.size());
+    out += text.size();
+    *out++ = quote_char;
+    size_t value_width = utf8_width(text) + 2;
+    if (value_width < VALUE_WIDTH) {
+        std::memset(out, ' ', VALUE_WIDTH - value_width);
+        out += VALUE_WIDTH - value_width;
+    }
+
+    return out - buffer;
+}
+
+/**
+ *  @brief Appends token, formatted like operator<<, to out. Reuse out to not
+ *  allocate once it has grown to a batch of Tokens.
+**/
+void append_formatted_token(std::string& out, const Token& token) {
+    size_t start = out.size();
+    out.resize(start + format_token_bound(token));
+    out.resize(start + format_token(token, &out[start], out.size() - start));
+}
+
 /**
  *  @brief Empty constructor. Creates an "undefined" Token.
 **/
 Token::Token() {
     this->type = "unknown";
+    this->kind = TokenKind::UNKNOWN;
+    this->name_id = NO_NAME_ID;
+    this->keyword = Keyword::NOT_A_KEYWORD;
     this->value = "undefined";
     this->line_start = -1;
     this->column_start = -1;
@@ -26,6 +180,9 @@ Token::Token(
     std::tuple<int, int> end
 ) {
     this->type = type;
+    this->kind = token_kind_from_string(type);
+    this->name_id = NO_NAME_ID;
+    this->keyword = Keyword::NOT_A_KEYWORD;
     this->value = std::string(1, value);
     this->line_start = std::get<0>(start);
     this->column_start = std::get<1>(start);
@@ -42,19 +199,60 @@ Token::Token(
     std::tuple<int, int> end
 ) {
     this->type = type;
+    this->kind = token_kind_from_string(type);
+    this->name_id = NO_NAME_ID;
+    this->keyword = Keyword::NOT_A_KEYWORD;
     this->value = value;
     this->line_start = std::get<0>(start);
     this->column_start = std::get<1>(start);
     this->line_end = std::get<0>(end);
     this->column_end = std::get<1>(end);
 }
+/**
+ *  @brief TokenKind constructor, skips the type name lookup.
+**/
+Token::Token(
+    TokenKind kind,
+    const std::string& value,
+    std::tuple<int, int> start,
+    std::tuple<int, int> end,
+    const TokenAttributes& attributes
+) {
+    this->type = token_kind_name(kind);
+    this->kind = kind;
+    this->name_id = attributes.name_id;
+    this->number = attributes.number;
+    this->keyword = attributes.keyword;
+    if (attributes.name_id != NO_NAME_ID) {
+        // NOTE: the Interner already holds a copy of the name
+        this->interned = attributes.name;
+    }
+    else {
+        this->value = value;
+    }
+    this->line_start = std::get<0>(start);
+    this->column_start = std::get<1>(start);
+    this->line_end = std::get<0>(end);
+    this->column_end = std::get<1>(end);
+}
+
+/**
+ *  @returns The Token's text, its value or its interned name.
+**/
+std::string_view Token::text() const {
+    if (this->name_id != NO_NAME_ID) {
+        return this->interned;
+    }
+    return this->value;
+}
 
 /**
  *  @brief Determines if single or double quotes can wrap the given Token value.
  *  @returns Returns single or double quotation character.
 **/
 char Token::get_quotes() const {
-    if (this->value.size() > 0 && this->value[0] == '\'') {
+    std::string_view text = this->text();
+    if (text.size() > 0 && text[0] == '\'') {
         return '"';
     }
 
@@ -66,34 +264,42 @@ char Token::get_quotes() const {
  *  @returns Token state information as a std::string.
 **/
 std::string Token::as_string() {
-    char quote_char = this->get_quotes();
-    std::string pos =
-        std::to_string(line_start) + "," +
-        std::to_string(column_start) + "-" +
-        std::to_string(line_end) + "," +
-        std::to_string(column_end) + ":";
+    char position[POSITION_BOUND];
+    size_t position_length = format_position(*this, position) - position;
 
-    return pos + "\t" + type + "\t" + quote_char + value + quote_char; 
+    std::string text;
+    text.reserve(position_length + this->type.size() + this->text().size() + 4);
+    text.append(position, position_length);
+    text += '\t';
+    text += this->type;
+    text += '\t';
+    text += this->get_quotes();
+    text += this->text();
+    text += this->get_quotes();
+    return text;
 }
 
 std::ostream& operator<<(std::ostream& os, const Token& token) {
-    char quote_char = token.get_quotes();
-    std::string pos =
-        std::to_string(token.line_start) + "," +
-        std::to_string(token.column_start) + "-" +
-        std::to_string(token.line_end) + "," +
-        std::to_string(token.column_end) + ":";
-    std::string val = quote_char + token.value + quote_char;
+    // NOTE: leaves os like the std::setw based version did, left adjusted
+    // with no pending width
+    os.setf(std::ios::left, std::ios::adjustfield);
+    os.width(0);
 
-    os << std::left << std::setw(20) << pos
-       << std::left << std::setw(15) << token.type 
-       << std::left << std::setw(15) << val;
+    char buffer[256];
+    size_t bound = format_token_bound(token);
+    if (bound <= sizeof(buffer)) {
+        os.write(buffer, format_token(token, buffer, sizeof(buffer)));
+    }
+    else {
+        std::string long_buffer(bound, '\0');
+        os.write(long_buffer.data(), format_token(token, long_buffer.data(), bound));
+    }
 
     return os;
 }
 
 bool operator==(const Token& lhs, const Token& rhs) {
-    return lhs.type == rhs.type && lhs.value == rhs.value;
+    return lhs.type == rhs.type && lhs.text() == rhs.text();
 }
 
 bool operator!=(const Token& lhs, const Token& rhs) {
@@ -101,11 +307,17 @@ bool operator!=(const Token& lhs, const Token& rhs) {
 }
 
 Token::operator std::string() {
-    char quote_char = this->get_quotes();
-    return 
-        std::to_string(this->line_start) + "," +
-        std::to_string(this->column_start) + "-" +
-        std::to_string(this->line_end) + "," +
-        std::to_string(this->column_end) + ": " +
-        this->type + " " + quote_char + this->value + quote_char;
+    char position[POSITION_BOUND];
+    size_t position_length = format_position(*this, position) - position;
+
+    std::string text;
+    text.reserve(position_length + this->type.size() + this->text().size() + 5);
+    text.append(position, position_length);
+    text += ' ';
+    text += this->type;
+    text += ' ';
+    text += this->get_quotes();
+    text += this->text();
+    text += this->get_quotes();
+    return text;
 }
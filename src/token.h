@@ -2,11 +2,81 @@
 #define TOKEN_H
 
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <cstdint>
+#include <cstddef>
+#include "keywords.h"
+
+enum class TokenKind {
+    ENCODING,
+    NAME,
+    NUMBER,
+    STRING,
+    OP,
+    COMMENT,
+    NL,
+    NEWLINE,
+    INDENT,
+    DEDENT,
+    ENDMARKER,
+    UNKNOWN
+};
+
+const int TOKEN_KIND_COUNT = (int)TokenKind::UNKNOWN + 1;
+
+const std::string& token_kind_name(TokenKind kind);
+TokenKind token_kind_from_string(const std::string& type);
+
+/**
+ *  @brief Bit for kind in a kind mask, see FilterSink.
+**/
+constexpr unsigned token_kind_bit(TokenKind kind) {
+    return 1u << (int)kind;
+}
+
+uint64_t token_fingerprint(TokenKind kind, std::string_view value);
+
+// NOTE: name_id of every Token that isn't an interned NAME
+const uint32_t NO_NAME_ID = UINT32_MAX;
+
+enum class NumberKind : uint8_t {
+    NONE,       // NOTE: not a NUMBER Token
+    INT,
+    FLOAT,
+    IMAGINARY
+};
+
+/**
+ *  @brief Value of a NUMBER Token, decoded while scanning it (see number-scanner.h).
+**/
+struct NumberValue {
+    NumberKind kind = NumberKind::NONE;
+    bool overflow = false;  // NOTE: INT too big for int64_t (a python int bigger than that), integer is 0
+    int64_t integer = 0;    // NOTE: INT value
+    double real = 0;        // NOTE: FLOAT value, or the imaginary part of an IMAGINARY
+};
+
+/**
+ *  @brief Extra information the tokenizer attaches to a Token besides its text.
+**/
+struct TokenAttributes {
+    uint32_t name_id = NO_NAME_ID;  // NOTE: only set when tokenizing with an Interner
+    std::string_view name;          // NOTE: the NAME in the Interner's arena, set with name_id
+    NumberValue number;             // NOTE: only set for NUMBER Tokens
+    Keyword keyword = Keyword::NOT_A_KEYWORD;  // NOTE: only set for NAME Tokens
+};
 
 class Token {
 	public:
+		// NOTE: value is empty for NAME Tokens with a name_id, their text is
+		// only kept once in the Interner, read it with text()
 		std::string type, value;
+		TokenKind kind;
+		uint32_t name_id;
+		std::string_view interned;  // NOTE: valid as long as the Interner
+		NumberValue number;
+		Keyword keyword;
 		int line_start, line_end, column_start, column_end;
 		
 		Token();
@@ -22,7 +92,15 @@ class Token {
             std::tuple<int, int> start,
             std::tuple<int, int> end
         );
+		Token(
+            TokenKind kind,
+            const std::string& value,
+            std::tuple<int, int> start,
+            std::tuple<int, int> end,
+            const TokenAttributes& attributes = TokenAttributes()
+        );
 
+        std::string_view text() const;
         char get_quotes() const;
 		std::string as_string();
         friend std::ostream& operator<<(std::ostream& os, const Token& token);
@@ -32,4 +110,8 @@ class Token {
     	operator std::string();
 };
 
+size_t format_token_bound(const Token& token);
+size_t format_token(const Token& token, char* buffer, size_t size);
+void append_formatted_token(std::string& out, const Token& token);
+
 #endif
@@ -0,0 +1,239 @@
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "unicode.h"
+#include "xid-tables.h"
+
+// NOTE: python identifiers are XID_Start XID_Continue*, see
+// https://docs.python.org/3/reference/lexical_analysis.html#identifiers
+// ASCII identifiers are by far the common case, so whole blocks of input are
+// first checked for high bytes and only blocks that have them get decoded.
+
+struct Utf8Table {
+    unsigned char length[256];
+};
+
+// NOTE: 0 marks bytes that can never start a sequence
+// (continuation bytes, overlong leads 0xC0/0xC1 and leads past U+10FFFF)
+static constexpr Utf8Table build_utf8_table() {
+    Utf8Table table{};
+    for (int c=0; c < 256; c++) {
+        if (c < 0x80) table.length[c] = 1;
+        else if (c >= 0xC2 && c <= 0xDF) table.length[c] = 2;
+        else if (c >= 0xE0 && c <= 0xEF) table.length[c] = 3;
+        else if (c >= 0xF0 && c <= 0xF4) table.length[c] = 4;
+        else table.length[c] = 0;
+    }
+    return table;
+}
+
+static constexpr Utf8Table utf8_table = build_utf8_table();
+static constexpr unsigned char utf8_lead_masks[5] = {0, 0x7F, 0x1F, 0x0F, 0x07};
+static constexpr uint32_t utf8_min_code_points[5] = {0, 0, 0x80, 0x800, 0x10000};
+
+struct AsciiIdentifierTable {
+    bool value[256];
+};
+
+// NOTE: matches the old NAME regex [a-zA-Z0-9_], high bytes are never set
+static constexpr AsciiIdentifierTable build_ascii_identifier_table() {
+    AsciiIdentifierTable table{};
+    for (int c=0; c < 128; c++) {
+        table.value[c] =
+            (c >= 'a' && c <= 'z') ||
+            (c >= 'A' && c <= 'Z') ||
+            (c >= '0' && c <= '9') ||
+            c == '_';
+    }
+    return table;
+}
+
+static constexpr AsciiIdentifierTable ascii_identifier = build_ascii_identifier_table();
+
+/**
+ *  @brief Checks ASCII_BLOCK_SIZE bytes for any byte with the high bit set.
+ *  @param data start of the block, must have ASCII_BLOCK_SIZE readable bytes.
+ *  @returns true if every byte in the block is ASCII.
+**/
+bool is_ascii_block(const char* data) {
+#if defined(__AVX2__)
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    return _mm256_movemask_epi8(block) == 0;
+#elif defined(__SSE2__)
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    return _mm_movemask_epi8(block) == 0;
+#else
+    uint64_t block;
+    std::memcpy(&block, data, sizeof(block));
+    return (block & 0x8080808080808080ULL) == 0;
+#endif
+}
+
+/**
+ *  @brief Checks an arbitrary sized buffer for any byte with the high bit set.
+ *  @param data start of the buffer.
+ *  @param size size of the buffer.
+ *  @returns true if every byte in the buffer is ASCII.
+**/
+bool is_ascii(const char* data, size_t size) {
+    size_t i = 0;
+
+    for (; i + ASCII_BLOCK_SIZE <= size; i += ASCII_BLOCK_SIZE) {
+        if (!is_ascii_block(data + i)) {
+            return false;
+        }
+    }
+    for (; i < size; i++) {
+        if ((unsigned char)data[i] >= 0x80) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ *  @brief Decodes a single UTF-8 sequence.
+ *  @param data start of the sequence.
+ *  @param size bytes available at data.
+ *  @param code_point set to the decoded code point on success.
+ *  @returns The length of the sequence in bytes, or -1 if it is malformed.
+**/
+int utf8_decode(const char* data, size_t size, uint32_t& code_point) {
+    if (size == 0) {
+        return -1;
+    }
+
+    int length = utf8_table.length[(unsigned char)data[0]];
+    if (length == 0 || (size_t)length > size) {
+        return -1;
+    }
+
+    uint32_t value = (unsigned char)data[0] & utf8_lead_masks[length];
+    for (int i=1; i < length; i++) {
+        unsigned char c = data[i];
+        if ((c & 0xC0) != 0x80) {
+            return -1;
+        }
+        value = (value << 6) | (c & 0x3F);
+    }
+
+    // NOTE: rejects overlong encodings, surrogates and anything past U+10FFFF
+    if (
+        value < utf8_min_code_points[length] ||
+        value > 0x10FFFF ||
+        (value >= 0xD800 && value <= 0xDFFF)
+    ) {
+        return -1;
+    }
+
+    code_point = value;
+    return length;
+}
+
+/**
+ *  @brief Counts the code points in a UTF-8 string, python reports columns in code points.
+ *  @param s string to measure.
+ *  @returns The number of code points in s.
+**/
+int utf8_width(std::string_view s) {
+    if (is_ascii(s.data(), s.size())) {
+        return s.size();
+    }
+
+    int width = 0;
+    for (unsigned char c : s) {
+        // NOTE: every byte except continuation bytes starts a code point
+        if ((c & 0xC0) != 0x80) {
+            width++;
+        }
+    }
+    return width;
+}
+
+static bool in_ranges(const CodePointRange* first, const CodePointRange* last, uint32_t code_point) {
+    const CodePointRange* it = std::upper_bound(
+        first,
+        last,
+        code_point,
+        [](uint32_t cp, const CodePointRange& range) { return cp < range.first; }
+    );
+    return it != first && code_point <= (it - 1)->last;
+}
+
+/**
+ *  @brief Checks if a non-ASCII code point can start an identifier.
+**/
+bool is_xid_start(uint32_t code_point) {
+    return in_ranges(std::begin(xid_start_ranges), std::end(xid_start_ranges), code_point);
+}
+
+/**
+ *  @brief Checks if a non-ASCII code point can continue an identifier.
+**/
+bool is_xid_continue(uint32_t code_point) {
+    return in_ranges(std::begin(xid_continue_ranges), std::end(xid_continue_ranges), code_point);
+}
+
+/**
+ *  @brief Scans the identifier starting at line[pos].
+ *  @param line line to scan.
+ *  @param pos byte position to start at.
+ *  @returns The length of the identifier in bytes, 0 if there is none at pos.
+**/
+size_t scan_identifier(const std::string& line, size_t pos) {
+    const char* data = line.data();
+    size_t size = line.size();
+    size_t i = pos;
+
+    while (i < size) {
+        size_t block_end = std::min(i + ASCII_BLOCK_SIZE, size);
+        bool ascii = (block_end - i == ASCII_BLOCK_SIZE)
+            ? is_ascii_block(data + i)
+            : is_ascii(data + i, block_end - i);
+
+        if (ascii) {
+            // NOTE: fast path, a single table lookup per byte
+            while (i < block_end && ascii_identifier.value[(unsigned char)data[i]]) {
+                i++;
+            }
+            if (i < block_end) {
+                return i - pos;
+            }
+            continue;
+        }
+
+        // NOTE: block has high bytes, decode it one code point at a time
+        while (i < block_end) {
+            unsigned char c = data[i];
+
+            if (c < 0x80) {
+                if (!ascii_identifier.value[c]) {
+                    return i - pos;
+                }
+                i++;
+                continue;
+            }
+
+            uint32_t code_point;
+            int length = utf8_decode(data + i, size - i, code_point);
+            if (length == -1) {
+                return i - pos;
+            }
+            bool valid = (i == pos) ? is_xid_start(code_point) : is_xid_continue(code_point);
+            if (!valid) {
+                return i - pos;
+            }
+            i += length;
+        }
+    }
+
+    return i - pos;
+}
@@ -0,0 +1,30 @@
+#ifndef UNICODE_H
+#define UNICODE_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+// NOTE: size of the blocks checked at once by is_ascii_block, picks the widest
+// vector unit the compiler was told about (-mavx2 gives 32, x86_64 always has 16)
+#if defined(__AVX2__)
+#define ASCII_BLOCK_SIZE 32
+#elif defined(__SSE2__)
+#define ASCII_BLOCK_SIZE 16
+#else
+#define ASCII_BLOCK_SIZE 8
+#endif
+
+bool is_ascii_block(const char* data);
+bool is_ascii(const char* data, size_t size);
+
+int utf8_decode(const char* data, size_t size, uint32_t& code_point);
+int utf8_width(std::string_view s);
+
+bool is_xid_start(uint32_t code_point);
+bool is_xid_continue(uint32_t code_point);
+
+size_t scan_identifier(const std::string& line, size_t pos);
+
+#endif
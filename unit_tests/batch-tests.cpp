@@ -0,0 +1,117 @@
+#include <string>
+#include <vector>
+#include <cstdio>
+#include "util.h"
+#include "batch-tokenizer.h"
+#include "unit-testing-util.h"
+#include "unit-tests.h"
+
+/**
+ *  @returns About size bytes of python source.
+**/
+static std::string generate_source(size_t size) {
+    std::string source;
+    for (int i=0; source.size() < size; i++) {
+        std::string n = std::to_string(i);
+        source +=
+            "def function_" + n + "(self, value=" + n + "):\n"
+            "    # comment " + n + "\n"
+            "    result = [value * 2, {'key': \"" + n + "\"}, (1.5e3, 0x" + n + ")]\n"
+            "    return self.call(result, '''text\n"
+            "    over lines''')\n"
+            "\n";
+    }
+    return source;
+}
+
+/**
+ *  @returns stdout of regex-tokenizer-main with args, split in lines.
+**/
+static std::vector<std::string> run_main(const std::string& args) {
+    std::string output = exec_command(("./regex-tokenizer-main " + args + " 2>/dev/null").c_str());
+    return split_on_newline(&output[0]);
+}
+
+/**
+ *  @brief Runs tokenize_batch on one worker.
+ *  @param order gets the index of every file, in the order the callback got them.
+ *  @returns Every Token of every file, in the order the callback got them.
+**/
+static std::vector<Token> run_batch(const std::vector<std::string>& fnames, const BatchOptions& options, std::vector<size_t>& order) {
+    std::vector<Token> tokens;
+    (void)tokenize_batch(fnames, options, [&](
+        const LoadedFile& file,
+        const std::vector<Token>& file_tokens,
+        const std::string&,
+        bool last
+    ) {
+        tokens.insert(tokens.end(), file_tokens.begin(), file_tokens.end());
+        if (last) {
+            order.push_back(file.index);
+        }
+    });
+    return tokens;
+}
+
+/**
+ *  @brief Checks that -u prints the same as tokenizing the files one after
+ *  the other, with and without streaming big files under -m, and that
+ *  tokenize_batch streams and orders files like it should.
+ *  @param silent toggles printing to std::cout on/off.
+ *  @returns true if every check passed.
+**/
+bool run_batch_tests(bool silent) {
+    bool passed = true;
+
+    // NOTE: with -j 2 -m 100 each worker gets 50MB, the first file fits and
+    // the second is streamed while the first is still being tokenized, so
+    // its chunks have to wait for the first file to be printed
+    std::vector<std::string> fnames = {
+        write_temporary_file(generate_source(300 * 1024)),
+        write_temporary_file(generate_source(700 * 1024)),
+        write_temporary_file(generate_source(2 * 1024)),
+        write_temporary_file(generate_source(10 * 1024)),
+    };
+    std::string files;
+    for (const std::string& fname : fnames) {
+        files += fname + " ";
+    }
+
+    std::vector<std::string> sequential = run_main(files);
+
+    std::vector<Token> expected;
+    std::vector<size_t> in_order;
+    for (size_t i=0; i < fnames.size(); i++) {
+        std::vector<Token> file_tokens = tokenize_source(read_file(fnames[i]));
+        expected.insert(expected.end(), file_tokens.begin(), file_tokens.end());
+        in_order.push_back(i);
+    }
+
+    // NOTE: a budget of 1 byte streams every file, one line at a time
+    for (bool io_uring : {false, true}) {
+        std::string backend = io_uring ? " (io_uring)" : " (pread)";
+        BatchOptions options;
+        options.loader.io_uring = io_uring;
+        options.loader.in_order = true;
+        options.loader.in_flight = 3;
+        options.memory_budget = 1;
+        options.stream_chunk = 100;
+
+        std::vector<size_t> order;
+        std::vector<Token> tokens = run_batch(fnames, options, order);
+        passed &= compare_results("streamed Tokens" + backend, token_lines(expected), token_lines(tokens), silent);
+        passed &= check("in order" + backend, order == in_order, silent);
+    }
+
+    std::string stats = exec_command(("./regex-tokenizer-main " + files + "-u -j 2 -m 100 2>&1 >/dev/null").c_str());
+    passed &= check("one file streamed", stats.find("1 of 4 files streamed") != std::string::npos, silent);
+
+    passed &= compare_results("-u", sequential, run_main(files + "-u -j 2"), silent);
+    passed &= compare_results("-u with a streamed file", sequential, run_main(files + "-u -j 2 -m 100"), silent);
+    passed &= compare_results("-u with all but the smallest file streamed", sequential, run_main(files + "-u -m 1"), silent);
+
+    for (const std::string& fname : fnames) {
+        std::remove(fname.c_str());
+    }
+    return passed;
+}
@@ -0,0 +1,116 @@
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "token.h"
+#include "regex-tokenizer.h"
+#include "regex-tokenizer-c.h"
+#include "unit-testing-util.h"
+#include "unit-tests.h"
+
+/**
+ *  @brief Describes every rtok_token of result like the matching Token, with
+ *  its text taken from the tokenized buffer. Newlines in the text are written
+ *  as \n, like Token values of multiline strings.
+**/
+static std::vector<std::string> span_lines(const std::string& buffer, rtok_result* result) {
+    std::vector<std::string> lines;
+    rtok_rewind(result);
+    const rtok_token* span;
+    while ((span = rtok_next(result)) != nullptr) {
+        std::string text;
+        for (char c : buffer.substr(span->offset, span->length)) {
+            text += c == '\n' ? std::string("\\n") : std::string(1, c);
+        }
+        lines.push_back(
+            std::string(rtok_kind_name(span->kind)) + " " +
+            std::to_string(span->line) + "," + std::to_string(span->col) + " " + text
+        );
+    }
+    return lines;
+}
+
+/**
+ *  @brief Describes tokens like span_lines, only kinds whose text is in the
+ *  buffer keep it.
+**/
+static std::vector<std::string> token_span_lines(const std::vector<Token>& tokens) {
+    std::vector<std::string> lines;
+    for (const Token& token : tokens) {
+        bool spans_text =
+            token.kind != TokenKind::ENCODING &&
+            token.kind != TokenKind::DEDENT &&
+            token.kind != TokenKind::ENDMARKER;
+        lines.push_back(
+            token.type + " " +
+            std::to_string(token.line_start) + "," + std::to_string(std::max(token.column_start, 0)) + " " +
+            (spans_text ? std::string(token.text()) : std::string())
+        );
+    }
+    return lines;
+}
+
+/**
+ *  @brief Checks the C ABI against the C++ Tokenizer: spans of the buffer,
+ *  iteration and invalid input.
+ *  @param silent toggles printing to std::cout on/off.
+ *  @returns true if every check passed.
+**/
+bool run_c_abi_tests(bool silent) {
+    bool passed = true;
+
+    passed &= check("ABI version", rtok_abi_version() == RTOK_ABI_VERSION, silent);
+    passed &= check("token layout", sizeof(rtok_token) == 24, silent);
+
+    std::string source =
+        "# caf\xC3\xA9\n"
+        "def f(\xCF\x80, b='''x\n"
+        "y'''):\n"
+        "    return \xCF\x80 + 0x1f  # done\n"
+        "\n"
+        "s = \"\xE2\x82\xAC\" + f(1, 2)\n";
+
+    rtok_result* result = rtok_tokenize(source.data(), source.size());
+    passed &= check("status", result != nullptr && rtok_status(result) == RTOK_OK && std::string(rtok_error(result)).empty(), silent);
+    if (result == nullptr) {
+        return false;
+    }
+
+    std::vector<Token> tokens = tokenize_source(source);
+    passed &= compare_results("spans", token_span_lines(tokens), span_lines(source, result), silent);
+
+    size_t count = 0;
+    rtok_rewind(result);
+    while (rtok_next(result) != nullptr) {
+        count++;
+    }
+    passed &= check("iteration", count == rtok_token_count(result) && rtok_next(result) == nullptr && rtok_tokens(result)[0].kind == RTOK_ENCODING, silent);
+    rtok_free(result);
+
+    // NOTE: without a newline at the end the NEWLINE Token is empty
+    std::string unterminated = "x = 1";
+    result = rtok_tokenize(unterminated.data(), unterminated.size());
+    passed &= compare_results("spans without a final newline", {
+        "ENCODING 0,0 ",
+        "NAME 1,0 x",
+        "OP 1,2 =",
+        "NUMBER 1,4 1",
+        "NEWLINE 1,5 ",
+        "ENDMARKER 2,0 ",
+    }, span_lines(unterminated, result), silent);
+    rtok_free(result);
+
+    std::string invalid = "if x:\n        a = 1\n    b = 2\n";
+    result = rtok_tokenize(invalid.data(), invalid.size());
+    bool kept = false;
+    for (size_t i=0; i < rtok_token_count(result); i++) {
+        kept |= rtok_tokens(result)[i].kind == RTOK_NEWLINE && rtok_tokens(result)[i].line == 2;
+    }
+    passed &= check("invalid input", rtok_status(result) == RTOK_ERROR && std::string(rtok_error(result)).find("unindent") != std::string::npos && kept, silent);
+    rtok_free(result);
+
+    result = rtok_tokenize("", 0);
+    passed &= check("empty buffer", rtok_status(result) == RTOK_OK && rtok_token_count(result) == 2, silent);
+    rtok_free(result);
+
+    return passed;
+}
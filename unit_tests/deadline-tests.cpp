@@ -0,0 +1,100 @@
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include "util.h"
+#include "token.h"
+#include "token-sink.h"
+#include "token-pipeline.h"
+#include "regex-tokenizer.h"
+#include "regex-tokenizer-c.h"
+#include "unit-testing-util.h"
+#include "unit-tests.h"
+
+/**
+ *  @returns true if part is the start of whole, printed the same.
+**/
+static bool is_prefix(const std::vector<Token>& part, const std::vector<Token>& whole) {
+    std::vector<std::string> part_lines = token_lines(part);
+    std::vector<std::string> whole_lines = token_lines(whole);
+    return part_lines.size() <= whole_lines.size() && std::equal(part_lines.begin(), part_lines.end(), whole_lines.begin());
+}
+
+/**
+ *  @brief Checks that deadlines and cancellation stop tokenizing with the
+ *  Tokens before that intact, in the Tokenizer, the pipeline and the C ABI.
+ *  @param silent toggles printing to std::cout on/off.
+ *  @returns true if every check passed.
+**/
+bool run_deadline_tests(bool silent) {
+    bool passed = true;
+
+    std::string source;
+    for (int i=0; i < 200; i++) {
+        source += "def f" + std::to_string(i) + "(x):\n    return [x, (x + 1)]\n";
+    }
+    std::vector<Token> all = tokenize_source(source);
+
+    {
+        Tokenizer tokenizer(split_lines(source));
+        passed &= check("no deadline", tokenizer.get_status() == TokenizeStatus::COMPLETE && tokenizer.size() == (int)all.size(), silent);
+    }
+
+    {
+        TokenizerOptions options;
+        options.deadline = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+        options.check_every = 1;
+        Tokenizer tokenizer(split_lines(source), options);
+        passed &= check("passed deadline", tokenizer.get_status() == TokenizeStatus::DEADLINE && tokenizer.size() < (int)all.size(), silent);
+    }
+
+    {
+        // NOTE: cancelled from the sink after 100 Tokens, everything before
+        // the stop has to be there and nothing may follow it
+        std::atomic<bool> cancel(false);
+        std::vector<Token> tokens;
+        TokenizerOptions options;
+        options.cancel = &cancel;
+        options.check_every = 1;
+        BasicTokenizer<CallbackSink> tokenizer(split_lines(source), CallbackSink([&](const Token& token) {
+            tokens.push_back(token);
+            if (tokens.size() == 100) {
+                cancel = true;
+            }
+        }), options);
+        passed &= check("cancelled", tokenizer.get_status() == TokenizeStatus::CANCELLED, silent);
+        passed &= check("cancelled Tokens are a prefix", tokens.size() >= 100 && tokens.size() < all.size() && is_prefix(tokens, all), silent);
+    }
+
+    {
+        std::atomic<bool> cancel(true);
+        TokenizerOptions options;
+        options.cancel = &cancel;
+        TokenPipeline pipeline(split_lines(source), 16, 4, options);
+        std::vector<Token> tokens, batch;
+        while (pipeline.next_batch(batch)) {
+            tokens.insert(tokens.end(), batch.begin(), batch.end());
+        }
+        passed &= check("cancelled pipeline", pipeline.get_status() == TokenizeStatus::CANCELLED && is_prefix(tokens, all) && tokens.size() < all.size(), silent);
+    }
+
+    rtok_result* result = rtok_tokenize_with_timeout(source.data(), source.size(), 0);
+    passed &= check("C ABI timeout", rtok_status(result) == RTOK_DEADLINE && rtok_token_count(result) < all.size(), silent);
+    rtok_free(result);
+
+    // NOTE: timeouts past the end of steady_clock used to overflow the
+    // deadline into the past
+    for (uint64_t timeout : {UINT64_MAX, (uint64_t)1 << 63, (uint64_t)1000000000000000000ull}) {
+        result = rtok_tokenize_with_timeout(source.data(), source.size(), timeout);
+        passed &= check(
+            "C ABI timeout " + std::to_string(timeout),
+            rtok_status(result) == RTOK_OK && rtok_token_count(result) == all.size(),
+            silent
+        );
+        rtok_free(result);
+    }
+
+    return passed;
+}
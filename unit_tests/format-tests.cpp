@@ -0,0 +1,85 @@
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <climits>
+#include "token.h"
+#include "unicode.h"
+#include "unit-testing-util.h"
+#include "unit-tests.h"
+
+/**
+ *  @brief token formatted the way operator<< did before format_token,
+ *  std::to_string for the position and std::setw for the padding.
+**/
+static std::string format_with_setw(const Token& token) {
+    char quote_char = token.get_quotes();
+    std::string pos =
+        std::to_string(token.line_start) + "," +
+        std::to_string(token.column_start) + "-" +
+        std::to_string(token.line_end) + "," +
+        std::to_string(token.column_end) + ":";
+    std::string val = quote_char + std::string(token.text()) + quote_char;
+    int val_padding = std::max(0, 15 - utf8_width(val));
+
+    std::ostringstream os;
+    os << std::left << std::setw(20) << pos
+       << std::left << std::setw(15) << token.type
+       << val << std::string(val_padding, ' ');
+    return os.str();
+}
+
+/**
+ *  @brief Checks format_token, append_formatted_token and operator<< against
+ *  the std::setw based format, and format_token's buffer handling.
+ *  @param silent toggles printing to std::cout on/off.
+ *  @returns true if every check passed.
+**/
+bool run_format_tests(bool silent) {
+    bool passed = true;
+
+    std::vector<Token> tokens = tokenize_source(
+        "x = 'it' + \"'q'\" + caf\xC3\xA9\n"
+        "s = '''a\n"
+        "b'''\n"
+        "very_long_name_past_the_value_width = 12345678901234567890\n"
+        "# \xE2\x82\xAC comment\n"
+    );
+    tokens.push_back(Token(TokenKind::OP, "(", {INT_MAX, INT_MIN}, {-1, INT_MAX}));
+    tokens.push_back(Token(TokenKind::STRING, std::string(300, 'v'), {1, 0}, {1, 300}));
+    tokens.push_back(Token("custom_type_longer_than_15", 'c', {1, 2}, {3, 4}));
+    tokens.push_back(Token());
+
+    std::vector<std::string> expected, streamed, appended, formatted;
+    std::string buffer;
+    for (const Token& token : tokens) {
+        expected.push_back(format_with_setw(token));
+
+        std::ostringstream os;
+        os << token;
+        streamed.push_back(os.str());
+
+        buffer.clear();
+        append_formatted_token(buffer, token);
+        appended.push_back(buffer);
+
+        std::string exact(format_token_bound(token), '\0');
+        exact.resize(format_token(token, &exact[0], exact.size()));
+        formatted.push_back(exact);
+    }
+    passed &= compare_results("operator<<", expected, streamed, silent);
+    passed &= compare_results("append_formatted_token", expected, appended, silent);
+    passed &= compare_results("format_token", expected, formatted, silent);
+
+    // NOTE: a buffer one byte short of the bound is left alone
+    const Token& token = tokens[1];
+    std::string small(format_token_bound(token) - 1, '#');
+    passed &= check("buffer too small", format_token(token, &small[0], small.size()) == 0 && small == std::string(small.size(), '#'), silent);
+
+    std::ostringstream os;
+    os << std::right << std::setw(40) << token << "|" << 7;
+    passed &= check("stream left adjusted without width", os.str() == expected[1] + "|7", silent);
+
+    return passed;
+}
@@ -0,0 +1,52 @@
+#include <string>
+#include <cstdint>
+#include "unicode.h"
+#include "unit-testing-util.h"
+#include "unit-tests.h"
+
+/**
+ *  @brief Checks scan_identifier and the UTF-8 helpers it is built on, then
+ *  non-ASCII NAME Tokens against 'python -m tokenize'.
+ *  @param silent toggles printing to std::cout on/off.
+ *  @returns true if every check passed.
+**/
+bool run_identifier_tests(bool silent) {
+    bool passed = true;
+
+    passed &= check("ascii identifier", scan_identifier("foo_bar1 = 2", 0) == 8, silent);
+    passed &= check("identifier ends at an operator", scan_identifier("ab+c", 0) == 2, silent);
+    passed &= check("identifier at pos", scan_identifier("x = _y2.z", 4) == 3, silent);
+
+    // NOTE: longer than ASCII_BLOCK_SIZE so the block at a time path runs,
+    // with the first non-ASCII byte past the first block
+    std::string long_name(2 * ASCII_BLOCK_SIZE + 3, 'a');
+    passed &= check("long ascii identifier", scan_identifier(long_name + "(", 0) == long_name.size(), silent);
+    passed &= check("long identifier ending in UTF-8", scan_identifier(long_name + "\xC3\xA9 ", 0) == long_name.size() + 2, silent);
+
+    passed &= check("UTF-8 identifier", scan_identifier("h\xC3\xA9llo = 1", 0) == 6, silent);
+    passed &= check("UTF-8 identifier start", scan_identifier("\xCF\x80 = 3", 0) == 2, silent);
+    // NOTE: U+00B7 MIDDLE DOT is XID_Continue but not XID_Start, tokenize.py
+    // matches names with \w and splits at it, so it is only checked here
+    passed &= check("XID_Continue only code point", scan_identifier("x\xC2\xB7y", 0) == 4, silent);
+    passed &= check("XID_Continue can't start", scan_identifier("\xC2\xB7y", 0) == 0, silent);
+    passed &= check("symbol isn't an identifier", scan_identifier("\xE2\x82\xAC", 0) == 0, silent);
+    passed &= check("malformed UTF-8 ends the identifier", scan_identifier("ab\xC3(", 0) == 2, silent);
+
+    uint32_t code_point = 0;
+    passed &= check("utf8_decode 3 bytes", utf8_decode("\xE2\x82\xAC", 3, code_point) == 3 && code_point == 0x20AC, silent);
+    passed &= check("utf8_decode overlong", utf8_decode("\xC0\x80", 2, code_point) == -1, silent);
+    passed &= check("utf8_decode truncated", utf8_decode("\xE2\x82", 2, code_point) == -1, silent);
+    passed &= check("utf8_width", utf8_width("na\xC3\xAFve \xE5\x90\x8D") == 7, silent);
+    passed &= check("is_ascii", is_ascii(long_name.data(), long_name.size()) && !is_ascii("abc\xC3\xA9", 5), silent);
+
+    passed &= compare_source_tokenization_results(
+        "UTF-8 NAME tokens",
+        "caf\xC3\xA9 = 1\n"
+        "\xCF\x80_2 = caf\xC3\xA9 * 2\n"
+        "na\xC3\xAFve_\xE5\x90\x8D\xE5\x89\x8D = [\xCF\x80_2, 1e3]\n"
+        "print(\"\xE2\x82\xAC\", na\xC3\xAFve_\xE5\x90\x8D\xE5\x89\x8D)\n",
+        silent
+    );
+
+    return passed;
+}
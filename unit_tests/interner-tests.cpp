@@ -0,0 +1,166 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include "token.h"
+#include "interner.h"
+#include "regex-tokenizer.h"
+#include "unit-testing-util.h"
+#include "unit-tests.h"
+
+/**
+ *  @brief Checks the Interner's ids and lookups, sharing it between threads,
+ *  and NAME Tokens tokenized with an Interner.
+ *  @param silent toggles printing to std::cout on/off.
+ *  @returns true if every check passed.
+**/
+bool run_interner_tests(bool silent) {
+    bool passed = true;
+
+    {
+        Interner interner;
+        uint32_t a = interner.intern("self");
+        uint32_t b = interner.intern("np");
+        std::string_view stored;
+        uint32_t again = interner.intern(std::string("self"), &stored);
+        passed &= check("dense ids", a == 0 && b == 1 && again == 0 && interner.size() == 2, silent);
+        passed &= check("stored view", stored == "self" && stored.data() == interner.lookup(0).data(), silent);
+        passed &= check("arena bytes", interner.arena_bytes() == 6, silent);
+        passed &= check("empty string", interner.intern("") == 2 && interner.lookup(2).empty(), silent);
+
+        bool threw = false;
+        try {
+            (void)interner.lookup(3);
+        }
+        catch (const std::runtime_error&) {
+            threw = true;
+        }
+        passed &= check("unknown id", threw, silent);
+    }
+
+    {
+        // NOTE: enough strings to grow the table several times and to fill
+        // more than one arena chunk, plus one bigger than a chunk
+        Interner interner;
+        std::vector<std::string> names;
+        for (int i=0; i < 20000; i++) {
+            names.push_back("name_" + std::to_string(i));
+        }
+        names.push_back(std::string(100 * 1024, 'x'));
+
+        bool dense = true;
+        for (size_t i=0; i < names.size(); i++) {
+            dense &= interner.intern(names[i]) == i;
+        }
+        bool stable = true;
+        for (size_t i=0; i < names.size(); i++) {
+            stable &= interner.intern(names[i]) == i && interner.lookup(i) == names[i];
+        }
+        passed &= check("ids after growing", dense && stable && interner.size() == names.size(), silent);
+    }
+
+    {
+        Interner interner;
+        std::vector<std::vector<uint32_t>> ids(4);
+        std::vector<std::thread> threads;
+        for (size_t t=0; t < ids.size(); t++) {
+            threads.emplace_back([&, t]() {
+                for (int i=0; i < 5000; i++) {
+                    ids[t].push_back(interner.intern("n" + std::to_string(i % 1000)));
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        bool same = interner.size() == 1000;
+        for (size_t t=1; t < ids.size(); t++) {
+            same &= ids[t] == ids[0];
+        }
+        for (int i=0; i < 1000; i++) {
+            same &= interner.lookup(ids[0][i]) == "n" + std::to_string(i);
+        }
+        passed &= check("shared between threads", same, silent);
+    }
+
+    {
+        // NOTE: every thread interns the same names in its own order, while
+        // looking up the ids it already has. Enough names to grow every shard
+        // and to need several id blocks
+        const size_t name_count = 50000;
+        Interner interner;
+        std::vector<std::vector<uint32_t>> ids(8, std::vector<uint32_t>(name_count));
+        std::vector<bool> lookups(ids.size(), true);
+        std::vector<std::thread> threads;
+        for (size_t t=0; t < ids.size(); t++) {
+            threads.emplace_back([&, t]() {
+                std::vector<size_t> order(name_count);
+                std::iota(order.begin(), order.end(), 0);
+                std::shuffle(order.begin(), order.end(), std::mt19937(t));
+                for (size_t i : order) {
+                    std::string name = "name_" + std::to_string(i);
+                    ids[t][i] = interner.intern(name);
+                    lookups[t] = lookups[t] && interner.lookup(ids[t][i]) == name;
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        bool same = interner.size() == name_count;
+        for (size_t t=0; t < ids.size(); t++) {
+            same &= ids[t] == ids[0] && lookups[t];
+        }
+        std::vector<uint32_t> sorted = ids[0];
+        std::sort(sorted.begin(), sorted.end());
+        bool dense = true;
+        for (size_t i=0; i < sorted.size(); i++) {
+            dense &= sorted[i] == i && interner.lookup(ids[0][i]) == "name_" + std::to_string(i);
+        }
+        passed &= check("ids are stable across threads", same, silent);
+        passed &= check("ids are dense across threads", dense && interner.arena_bytes() > 0, silent);
+    }
+
+    std::string source =
+        "import numpy as np\n"
+        "def f(self, x):\n"
+        "    return np.sum(self.x) + x\n";
+    std::string other = "y = np.zeros(3)\n";
+
+    Interner interner;
+    TokenizerOptions options;
+    options.interner = &interner;
+    std::vector<Token> plain = tokenize_source(source);
+    std::vector<Token> interned = tokenize_source(source, options);
+    std::vector<Token> interned_other = tokenize_source(other, options);
+
+    passed &= compare_results("interned Tokens print the same", token_lines(plain), token_lines(interned), silent);
+
+    bool ids = true;
+    for (const Token& token : interned) {
+        if (token.kind == TokenKind::NAME) {
+            ids &= token.name_id != NO_NAME_ID && token.value.empty() && token.text() == interner.lookup(token.name_id);
+        }
+        else {
+            ids &= token.name_id == NO_NAME_ID;
+        }
+    }
+    passed &= check("only NAME Tokens get an id", ids, silent);
+
+    uint32_t np = interner.intern("np");
+    uint32_t np_uses = 0;
+    for (const std::vector<Token>* tokens : {&interned, &interned_other}) {
+        for (const Token& token : *tokens) {
+            np_uses += token.name_id == np;
+        }
+    }
+    passed &= check("ids are shared between Tokenizers", np_uses == 3 && interned[1] == plain[1], silent);
+
+    return passed;
+}
@@ -0,0 +1,123 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <iostream>
+#include <cctype>
+#include "token.h"
+#include "keywords.h"
+#include "line-cache.h"
+#include "regex-tokenizer.h"
+#include "unit-testing-util.h"
+#include "unit-tests.h"
+
+/**
+ *  @returns word with the case of every letter flipped.
+**/
+static std::string flip_case(std::string_view word) {
+    std::string flipped(word);
+    for (char& c : flipped) {
+        c = std::isupper((unsigned char)c) ? std::tolower((unsigned char)c) : std::toupper((unsigned char)c);
+    }
+    return flipped;
+}
+
+/**
+ *  @returns "value keyword_name" for every NAME Token.
+**/
+static std::vector<std::string> keyword_lines(const std::vector<Token>& tokens) {
+    std::vector<std::string> lines;
+    for (const Token& token : tokens) {
+        if (token.kind == TokenKind::NAME) {
+            lines.push_back(token.value + " " + std::string(keyword_name(token.keyword)));
+        }
+    }
+    return lines;
+}
+
+/**
+ *  @brief Checks classify_keyword on every keyword and on near misses, then
+ *  Token::keyword of tokenized source.
+ *  @param silent toggles printing to std::cout on/off.
+ *  @returns true if every check passed.
+**/
+bool run_keyword_tests(bool silent) {
+    bool passed = true;
+
+    bool all_found = true;
+    bool no_near_misses = true;
+    for (int i=1; i < KEYWORD_COUNT; i++) {
+        std::string_view name = keyword_names[i];
+        all_found &= classify_keyword(name) == (Keyword)i;
+
+        // NOTE: same length, first and last characters as a keyword land in
+        // its slot and only the string compare rejects them
+        std::vector<std::string> misses = {
+            flip_case(name),
+            std::string(name) + "_",
+            std::string(name) + "s",
+            "_" + std::string(name),
+            std::string(name.substr(0, name.size() - 1)),
+            std::string(name.substr(1)),
+        };
+        if (name.size() >= 3) {
+            misses.push_back(std::string(name.substr(0, 1)) + "x" + std::string(name.substr(2)));
+        }
+        for (const std::string& miss : misses) {
+            Keyword keyword = classify_keyword(miss);
+            bool expected = false;
+            for (int j=1; j < KEYWORD_COUNT; j++) {
+                expected |= keyword_names[j] == miss && keyword == (Keyword)j;
+            }
+            if (!expected && keyword != Keyword::NOT_A_KEYWORD) {
+                no_near_misses = false;
+                if (!silent) {
+                    std::cout << "\"" << miss << "\" classified as " << keyword_name(keyword) << std::endl;
+                }
+            }
+        }
+    }
+    passed &= check("every keyword classified", all_found, silent);
+    passed &= check("near misses are NAMEs", no_near_misses, silent);
+    passed &= check("empty and long words", classify_keyword("") == Keyword::NOT_A_KEYWORD && classify_keyword("nonlocals") == Keyword::NOT_A_KEYWORD, silent);
+    passed &= check("soft keywords", is_soft_keyword(Keyword::MATCH) && is_soft_keyword(Keyword::CASE) && is_soft_keyword(Keyword::TYPE) && is_soft_keyword(Keyword::UNDERSCORE) && !is_soft_keyword(Keyword::YIELD), silent);
+
+    // NOTE: soft keywords are classified by spelling, whether they act as
+    // keywords where they are is up to the parser. Strings and comments
+    // spelling a keyword are not NAMEs
+    std::string source =
+        "match = case(_)\n"
+        "match command:\n"
+        "    case [x, _] if x is not None:\n"
+        "        type Point = tuple[float, float]\n"
+        "async def f(): return await g('if', \"else\")  # while\n"
+        "Match, CASE, Type, __, _x, lambdas = True, False, None, 1, 2, 3\n";
+    std::vector<std::string> expected = {
+        "match match", "case case", "_ _",
+        "match match", "command ",
+        "case case", "x ", "_ _", "if if", "x ", "is is", "not not", "None None",
+        "type type", "Point ", "tuple ", "float ", "float ",
+        "async async", "def def", "f ", "return return", "await await", "g ",
+        "Match ", "CASE ", "Type ", "__ ", "_x ", "lambdas ", "True True", "False False", "None None",
+    };
+    std::vector<Token> tokens = tokenize_source(source);
+    passed &= compare_results("Token::keyword", expected, keyword_lines(tokens), silent);
+    bool only_names = true;
+    for (const Token& token : tokens) {
+        only_names &= token.kind == TokenKind::NAME || token.keyword == Keyword::NOT_A_KEYWORD;
+    }
+    passed &= check("only NAMEs have a keyword", only_names, silent);
+
+    // NOTE: replayed lines keep their Tokens' keywords
+    LineCache line_cache;
+    TokenizerOptions options;
+    options.line_cache = &line_cache;
+    std::string repeated = "if x:\n    pass\nif x:\n    pass\n";
+    passed &= compare_results(
+        "Token::keyword from the line cache",
+        keyword_lines(tokenize_source(repeated)),
+        keyword_lines(tokenize_source(repeated, options)),
+        silent
+    );
+
+    return passed;
+}
@@ -0,0 +1,84 @@
+#include <string>
+#include <vector>
+#include "token.h"
+#include "line-cache.h"
+#include "interner.h"
+#include "regex-tokenizer.h"
+#include "unit-testing-util.h"
+#include "unit-tests.h"
+
+/**
+ *  @brief Checks that Tokens replayed from a LineCache are the Tokens the
+ *  lines tokenize to, and which lines get cached.
+ *  @param silent toggles printing to std::cout on/off.
+ *  @returns true if every check passed.
+**/
+bool run_line_cache_tests(bool silent) {
+    bool passed = true;
+
+    // NOTE: the same lines at different indents, inside brackets and inside a
+    // multiline string, where they must not be replayed
+    std::string source =
+        "import os\n"
+        "x = 0x10 + 1.5j  # comment\n"
+        "import os\n"
+        "if x:\n"
+        "    x = 0x10 + 1.5j  # comment\n"
+        "    import os\n"
+        "    y = f(\n"
+        "    import_os,\n"
+        "    )\n"
+        "    s = '''\n"
+        "x = 0x10 + 1.5j  # comment\n"
+        "'''\n"
+        "x = 0x10 + 1.5j  # comment\n";
+
+    std::vector<Token> plain = tokenize_source(source);
+
+    LineCache line_cache;
+    TokenizerOptions options;
+    options.line_cache = &line_cache;
+    std::vector<Token> cached = tokenize_source(source, options);
+    LineCacheStats first = line_cache.stats();
+
+    passed &= compare_results("cached Tokens", token_lines(plain), token_lines(cached), silent);
+
+    bool numbers = plain.size() == cached.size();
+    for (size_t i=0; numbers && i < plain.size(); i++) {
+        numbers &=
+            plain[i].number.kind == cached[i].number.kind &&
+            plain[i].number.integer == cached[i].number.integer &&
+            plain[i].number.real == cached[i].number.real &&
+            plain[i].keyword == cached[i].keyword;
+    }
+    passed &= check("replayed NUMBER values and keywords", numbers, silent);
+
+    // NOTE: "import os" twice at indent 0, the x line once more at indent 0,
+    // the lines inside the brackets and the string are never looked up
+    passed &= check("hits within one file", first.hits == 2 && first.lookups == 9, silent);
+
+    std::vector<Token> again = tokenize_source(source, options);
+    LineCacheStats second = line_cache.stats();
+    passed &= compare_results("Tokens from a shared cache", token_lines(plain), token_lines(again), silent);
+    // NOTE: the lines ending inside the brackets and the string are never
+    // cached, so they miss again
+    passed &= check("other lines hit the second time", second.hits - first.hits == 7 && second.lookups - first.lookups == 9 && second.lines == first.lines, silent);
+
+    Interner interner;
+    options.interner = &interner;
+    std::vector<Token> interned = tokenize_source(source, options);
+    bool ids = true;
+    for (const Token& token : interned) {
+        ids &= (token.kind == TokenKind::NAME) == (token.name_id != NO_NAME_ID);
+    }
+    passed &= check("replayed NAMEs are interned", ids && interner.size() > 0, silent);
+
+    LineCache small(1);
+    options = TokenizerOptions();
+    options.line_cache = &small;
+    std::vector<Token> limited = tokenize_source(source, options);
+    passed &= compare_results("Tokens with a full cache", token_lines(plain), token_lines(limited), silent);
+    passed &= check("max_lines", small.stats().lines == 1, silent);
+
+    return passed;
+}
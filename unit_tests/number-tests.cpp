@@ -0,0 +1,72 @@
+#include <string>
+#include <cstdint>
+#include <cmath>
+#include "token.h"
+#include "number-scanner.h"
+#include "unit-testing-util.h"
+#include "unit-tests.h"
+
+/**
+ *  @brief True if the NUMBER at the start of text is length bytes of an INT.
+**/
+static bool scans_int(const std::string& text, size_t length, int64_t integer) {
+    NumberMatch match = scan_number(text, 0);
+    return
+        match.length == length &&
+        match.value.kind == NumberKind::INT &&
+        !match.value.overflow &&
+        match.value.integer == integer;
+}
+
+/**
+ *  @brief True if the NUMBER at the start of text is length bytes of kind
+ *  (FLOAT or IMAGINARY) with the given real (or imaginary) part.
+**/
+static bool scans_real(const std::string& text, size_t length, NumberKind kind, double real) {
+    NumberMatch match = scan_number(text, 0);
+    return match.length == length && match.value.kind == kind && match.value.real == real;
+}
+
+/**
+ *  @brief Checks scan_number's matches and decoded values, then NUMBER Tokens
+ *  against 'python -m tokenize'.
+ *  @param silent toggles printing to std::cout on/off.
+ *  @returns true if every check passed.
+**/
+bool run_number_tests(bool silent) {
+    bool passed = true;
+
+    passed &= check("decimal int", scans_int("1234)", 4, 1234), silent);
+    passed &= check("underscores", scans_int("1_000_000", 9, 1000000), silent);
+    passed &= check("trailing underscore", scans_int("1_", 1, 1), silent);
+    passed &= check("hex", scans_int("0xFF_ff", 7, 0xffff), silent);
+    passed &= check("octal", scans_int("0o_17", 5, 15), silent);
+    passed &= check("binary", scans_int("0B101", 5, 5), silent);
+    passed &= check("prefix without digits", scans_int("0x", 1, 0), silent);
+    passed &= check("leading zeros", scans_int("0777", 1, 0) && scans_int("00_0", 4, 0), silent);
+    passed &= check("int64 max", scans_int("9223372036854775807", 19, INT64_MAX), silent);
+
+    NumberMatch big = scan_number("9223372036854775808", 0);
+    passed &= check("int overflow", big.length == 19 && big.value.kind == NumberKind::INT && big.value.overflow && big.value.integer == 0, silent);
+
+    passed &= check("float", scans_real("3.25", 4, NumberKind::FLOAT, 3.25), silent);
+    passed &= check("float without integer part", scans_real(".5", 2, NumberKind::FLOAT, 0.5), silent);
+    passed &= check("float without fraction", scans_real("2.", 2, NumberKind::FLOAT, 2.0), silent);
+    passed &= check("exponent", scans_real("1e3", 3, NumberKind::FLOAT, 1000.0) && scans_real("2.5E-1", 6, NumberKind::FLOAT, 0.25), silent);
+    passed &= check("exponent without digits", scans_int("1e", 1, 1) && scans_int("1e+x", 1, 1), silent);
+    passed &= check("leading zeros float", scans_real("0777.5", 6, NumberKind::FLOAT, 777.5), silent);
+    passed &= check("imaginary", scans_real("3j", 2, NumberKind::IMAGINARY, 3.0) && scans_real("1.5e1J", 6, NumberKind::IMAGINARY, 15.0), silent);
+    passed &= check("huge float", scans_real("1e400", 5, NumberKind::FLOAT, HUGE_VAL), silent);
+    passed &= check("no number", scan_number(".", 0).length == 0 && scan_number("x1", 0).length == 0, silent);
+
+    passed &= compare_source_tokenization_results(
+        "number tokens",
+        "a = 1 + 1_000 + 0x_ff + 0o17 + 0b1 + 0777 + 00\n"
+        "b = 3.14 + .5 + 2. + 1e10 + 1E-5 + 1_0.0_1e+1_0\n"
+        "c = 3j + 1.5J + 1e3j + 0xj + 1_x + 1if 1else 2\n"
+        "d = x.y + 1..real + 9223372036854775808\n",
+        silent
+    );
+
+    return passed;
+}
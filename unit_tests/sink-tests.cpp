@@ -0,0 +1,142 @@
+#include <string>
+#include <vector>
+#include <array>
+#include <deque>
+#include <iterator>
+#include <utility>
+#include <algorithm>
+#include "util.h"
+#include "token.h"
+#include "token-sink.h"
+#include "span-sink.h"
+#include "interner.h"
+#include "line-cache.h"
+#include "structure-index.h"
+#include "regex-tokenizer.h"
+#include "unit-testing-util.h"
+#include "unit-tests.h"
+
+/**
+ *  @brief Describes the start and text of every Token with a byte range of
+ *  source, like c-abi-tests.cpp, from a SpanSink run. Newlines in the text
+ *  are written as \n, like Token values of multiline strings.
+**/
+static std::vector<std::string> span_sink_lines(const std::string& source, const TokenizerOptions& options) {
+    std::vector<std::string> lines = split_lines(source);
+    std::vector<size_t> line_offsets;
+    size_t offset = 0;
+    for (const std::string& line : lines) {
+        line_offsets.push_back(offset);
+        offset += line.size() + 1;
+    }
+    line_offsets.push_back(source.size());
+
+    std::vector<rtok_token> spans;
+    BasicTokenizer<SpanSink> tokenizer(std::move(lines), SpanSink(source.data(), &line_offsets, &spans), options);
+
+    std::vector<std::string> described;
+    for (const rtok_token& span : spans) {
+        std::string text;
+        for (char c : source.substr(span.offset, span.length)) {
+            text += c == '\n' ? std::string("\\n") : std::string(1, c);
+        }
+        described.push_back(
+            std::string(token_kind_name((TokenKind)span.kind)) + " " +
+            std::to_string(span.line) + "," + std::to_string(span.col) + " " + text
+        );
+    }
+    return described;
+}
+
+/**
+ *  @brief Describes tokens like span_sink_lines, from their values. Kinds
+ *  with no text in the source have none.
+**/
+static std::vector<std::string> token_start_lines(const std::vector<Token>& tokens) {
+    std::vector<std::string> described;
+    for (const Token& token : tokens) {
+        bool has_text =
+            token.kind != TokenKind::ENCODING &&
+            token.kind != TokenKind::DEDENT &&
+            token.kind != TokenKind::ENDMARKER;
+        described.push_back(
+            token.type + " " +
+            std::to_string(token.line_start) + "," + std::to_string(std::max(token.column_start, 0)) + " " +
+            (has_text ? std::string(token.text()) : std::string())
+        );
+    }
+    return described;
+}
+
+/**
+ *  @brief Checks CountingSink, FilterSink and SpanSink (wants_values = false)
+ *  against the Tokens of a VectorSink run, with and without the options
+ *  that make the tokenizer build values anyway.
+ *  @param silent toggles printing to std::cout on/off.
+ *  @returns true if every check passed.
+**/
+bool run_sink_tests(bool silent) {
+    bool passed = true;
+
+    // NOTE: repeated lines for the line cache, multiline strings and
+    // brackets move positions across lines, non-ASCII moves columns
+    std::string source =
+        "import os  # caf\xC3\xA9\n"
+        "def f(\xCF\x80, b='''x\n"
+        "y'''):\n"
+        "    x = [1,\n"
+        "         2]  # a\n"
+        "    x = [1,\n"
+        "         2]  # a\n"
+        "    return \xCF\x80 + 0x1f\n"
+        "\n"
+        "s = \"\xE2\x82\xAC\" + f(1, 2)\n"
+        "s = \"\xE2\x82\xAC\" + f(1, 2)\n";
+
+    Interner interner;
+    LineCache line_cache;
+    std::deque<StructureIndex> structures;
+
+    for (bool values : {false, true}) {
+        std::string suffix = values ? " with interner, line cache and structure" : "";
+        // NOTE: a StructureIndex is one per Tokenizer, the others are shared
+        auto make_options = [&]() {
+            TokenizerOptions options;
+            if (values) {
+                options.interner = &interner;
+                options.line_cache = &line_cache;
+                structures.emplace_back();
+                options.structure = &structures.back();
+            }
+            return options;
+        };
+        std::vector<Token> tokens = tokenize_source(source, make_options());
+
+        std::array<size_t, TOKEN_KIND_COUNT> expected_counts{};
+        for (const Token& token : tokens) {
+            expected_counts[(int)token.kind]++;
+        }
+        CountingSink counting = BasicTokenizer<CountingSink>(split_lines(source), CountingSink(), make_options()).get_sink();
+        passed &= check("CountingSink counts" + suffix, counting.counts == expected_counts && counting.total == tokens.size(), silent);
+
+        const unsigned masks[] = {
+            token_kind_bit(TokenKind::NAME),
+            token_kind_bit(TokenKind::NAME) | token_kind_bit(TokenKind::OP),
+            ~(token_kind_bit(TokenKind::COMMENT) | token_kind_bit(TokenKind::NL)),
+            ~0u,
+            0u,
+        };
+        for (unsigned mask : masks) {
+            std::vector<Token> expected;
+            std::copy_if(tokens.begin(), tokens.end(), std::back_inserter(expected), [&](const Token& token) {
+                return (mask & token_kind_bit(token.kind)) != 0;
+            });
+            FilterSink filter = BasicTokenizer<FilterSink>(split_lines(source), FilterSink(mask), make_options()).get_sink();
+            passed &= compare_results("FilterSink mask " + std::to_string(mask) + suffix, token_lines(expected), token_lines(filter.tokens), silent);
+        }
+
+        passed &= compare_results("SpanSink positions" + suffix, token_start_lines(tokens), span_sink_lines(source, make_options()), silent);
+    }
+
+    return passed;
+}
@@ -0,0 +1,59 @@
+#include <string>
+#include "string-scanner.h"
+#include "unit-testing-util.h"
+#include "unit-tests.h"
+
+/**
+ *  @brief True if scan_string(line, pos) gives type and length.
+**/
+static bool scans_as(const std::string& line, size_t pos, StringScan type, size_t length) {
+    StringMatch match = scan_string(line, pos);
+    return match.type == type && match.length == length;
+}
+
+/**
+ *  @brief Checks scan_string, its prefixes and escapes, then string Tokens
+ *  against 'python -m tokenize'.
+ *  @param silent toggles printing to std::cout on/off.
+ *  @returns true if every check passed.
+**/
+bool run_string_tests(bool silent) {
+    bool passed = true;
+
+    passed &= check("plain string", scans_as("'abc' + x", 0, StringScan::STRING, 5), silent);
+    passed &= check("string at pos", scans_as("x = \"abc\"", 4, StringScan::STRING, 5), silent);
+    passed &= check("empty string", scans_as("''", 0, StringScan::STRING, 2), silent);
+    passed &= check("escaped quote", scans_as("'a\\'b' c", 0, StringScan::STRING, 6), silent);
+    passed &= check("escaped backslash", scans_as("'a\\\\' c'", 0, StringScan::STRING, 5), silent);
+    passed &= check("raw string keeps the escaped quote", scans_as("r\"\\\"\"", 0, StringScan::STRING, 5), silent);
+    passed &= check("other quote inside", scans_as("\"it's\"", 0, StringScan::STRING, 6), silent);
+    passed &= check("unterminated string", scans_as("'abc", 0, StringScan::NONE, 0), silent);
+    passed &= check("no string", scans_as("abc", 0, StringScan::NONE, 0), silent);
+
+    passed &= check("one char prefixes", string_prefix_length("b''", 0) == 1 && string_prefix_length("F''", 0) == 1 && string_prefix_length("u''", 0) == 1, silent);
+    passed &= check("two char prefixes", string_prefix_length("Rb''", 0) == 2 && string_prefix_length("fR''", 0) == 2 && string_prefix_length("bR''", 0) == 2, silent);
+    passed &= check("invalid prefixes", string_prefix_length("ub''", 0) == 0 && string_prefix_length("bf''", 0) == 0 && string_prefix_length("x''", 0) == 0, silent);
+
+    passed &= check("closed triple string", scans_as("'''a'b''c''' + 1", 0, StringScan::STRING, 12), silent);
+    passed &= check("open triple string", scans_as("x = \"\"\"abc", 4, StringScan::OPEN_TRIPLE, 6), silent);
+    passed &= check("escaped triple quote", scans_as("'''\\''''", 0, StringScan::STRING, 8), silent);
+    passed &= check("find_string_end for a continued triple", find_string_end("abc\"\"\" + 1", 0, '"', true) == 6, silent);
+
+    // NOTE: quotes after an unterminated string don't make the scan quadratic
+    std::string quotes = "'" + std::string(10000, '\\') + "x";
+    passed &= check("long unterminated string", scans_as(quotes, 0, StringScan::NONE, 0), silent);
+
+    // NOTE: python prints values with repr(), which escapes backslashes and
+    // picks the quotes from the whole value, escapes are only checked above
+    passed &= compare_source_tokenization_results(
+        "string tokens",
+        "a = 'x' \"y\" b\"z\" Rb\"d\" f\"{a}\" U\"u\" rb\"\"\"r\"\"\"\n"
+        "b = '''one\n"
+        "two ''' + \"\"\"three\"\"\" + '''\n"
+        "'''\n"
+        "c = F\"{b}\" 'a' 'b'\n",
+        silent
+    );
+
+    return passed;
+}
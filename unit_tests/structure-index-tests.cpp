@@ -0,0 +1,101 @@
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "token.h"
+#include "structure-index.h"
+#include "regex-tokenizer.h"
+#include "unit-testing-util.h"
+#include "unit-tests.h"
+
+/**
+ *  @returns The text of tokens[range.begin] to tokens[range.end-1] separated
+ *  by spaces, NEWLINE and NL by their type.
+**/
+static std::string range_text(const std::vector<Token>& tokens, TokenRange range) {
+    std::string text;
+    for (uint32_t i=range.begin; i < range.end && i < tokens.size(); i++) {
+        bool layout = tokens[i].kind == TokenKind::NEWLINE || tokens[i].kind == TokenKind::NL;
+        text += (i > range.begin ? " " : "") + (layout ? tokens[i].type : std::string(tokens[i].text()));
+    }
+    return text;
+}
+
+/**
+ *  @brief Checks the StructureIndex built while tokenizing against the
+ *  Tokens it indexes.
+ *  @param silent toggles printing to std::cout on/off.
+ *  @returns true if every check passed.
+**/
+bool run_structure_index_tests(bool silent) {
+    bool passed = true;
+
+    std::string source =
+        "# leading comment\n"
+        "def f(a, b=[1, {2: (3)}]):\n"
+        "    # comment\n"
+        "\n"
+        "    if a:\n"
+        "        return (a +\n"
+        "                b)\n"
+        "    return b[0]\n"
+        "x = f(1)\n";
+
+    StructureIndex structure;
+    TokenizerOptions options;
+    options.structure = &structure;
+    std::vector<Token> tokens = tokenize_source(source, options);
+
+    passed &= check("one entry per Token", structure.size() == tokens.size(), silent);
+
+    std::vector<uint32_t> open;
+    bool brackets = true;
+    for (uint32_t i=0; i < tokens.size(); i++) {
+        std::string_view text = tokens[i].text();
+        bool is_op = tokens[i].kind == TokenKind::OP;
+        if (is_op && (text == "(" || text == "[" || text == "{")) {
+            open.push_back(i);
+        }
+        else if (is_op && (text == ")" || text == "]" || text == "}") && !open.empty()) {
+            uint32_t match = open.back();
+            open.pop_back();
+            brackets &= structure.matching_bracket(i) == match && structure.matching_bracket(match) == i;
+        }
+        else {
+            brackets &= structure.matching_bracket(i) == NO_TOKEN;
+        }
+    }
+    brackets &= structure.matching_bracket(tokens.size()) == NO_TOKEN;
+    passed &= check("matching brackets", brackets, silent);
+
+    std::vector<std::string> lines;
+    for (TokenRange range : structure.logical_lines()) {
+        lines.push_back(range_text(tokens, range));
+    }
+    passed &= compare_results("logical lines", {
+        "def f ( a , b = [ 1 , { 2 : ( 3 ) } ] ) : NEWLINE",
+        "if a : NEWLINE",
+        "return ( a + NL b ) NEWLINE",
+        "return b [ 0 ] NEWLINE",
+        "x = f ( 1 ) NEWLINE",
+    }, lines, silent);
+
+    bool blocks = structure.blocks().size() == 2;
+    for (TokenRange block : structure.blocks()) {
+        blocks &=
+            block.end != NO_TOKEN &&
+            tokens[block.begin].kind == TokenKind::INDENT &&
+            tokens[block.end-1].kind == TokenKind::DEDENT;
+    }
+    if (blocks) {
+        TokenRange outer = structure.blocks()[0];
+        TokenRange inner = structure.blocks()[1];
+        blocks &=
+            outer.begin < inner.begin && inner.end <= outer.end &&
+            tokens[outer.begin+1].text() == "if" &&
+            tokens[inner.begin+1].text() == "return" &&
+            tokens[outer.end].text() == "x";
+    }
+    passed &= check("indented blocks", blocks, silent);
+
+    return passed;
+}
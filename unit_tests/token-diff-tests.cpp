@@ -0,0 +1,127 @@
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include "token.h"
+#include "token-diff.h"
+#include "unit-testing-util.h"
+#include "unit-tests.h"
+
+/**
+ *  @brief Checks that edits, applied to a, give b: in order, not
+ *  overlapping, and everything between them unchanged.
+ *  @param cost set to the number of Tokens deleted plus inserted.
+**/
+static bool applies(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b, const std::vector<TokenEdit>& edits, size_t& cost) {
+    std::vector<uint64_t> result;
+    uint32_t a_pos = 0;
+    uint32_t b_pos = 0;
+    cost = 0;
+    for (const TokenEdit& edit : edits) {
+        if (
+            edit.old_tokens.begin < a_pos || edit.old_tokens.end < edit.old_tokens.begin || edit.old_tokens.end > a.size() ||
+            edit.new_tokens.begin < b_pos || edit.new_tokens.end < edit.new_tokens.begin || edit.new_tokens.end > b.size() ||
+            edit.old_tokens.begin - a_pos != edit.new_tokens.begin - b_pos
+        ) {
+            return false;
+        }
+        result.insert(result.end(), a.begin() + a_pos, a.begin() + edit.old_tokens.begin);
+        result.insert(result.end(), b.begin() + edit.new_tokens.begin, b.begin() + edit.new_tokens.end);
+        cost += (edit.old_tokens.end - edit.old_tokens.begin) + (edit.new_tokens.end - edit.new_tokens.begin);
+        a_pos = edit.old_tokens.end;
+        b_pos = edit.new_tokens.end;
+    }
+    result.insert(result.end(), a.begin() + a_pos, a.end());
+    return result == b;
+}
+
+/**
+ *  @returns The fewest deletions plus insertions turning a into b, from the
+ *  longest common subsequence.
+**/
+static size_t edit_distance(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b) {
+    std::vector<std::vector<size_t>> lcs(a.size() + 1, std::vector<size_t>(b.size() + 1, 0));
+    for (size_t i=1; i <= a.size(); i++) {
+        for (size_t j=1; j <= b.size(); j++) {
+            lcs[i][j] = a[i-1] == b[j-1] ? lcs[i-1][j-1] + 1 : std::max(lcs[i-1][j], lcs[i][j-1]);
+        }
+    }
+    return a.size() + b.size() - 2 * lcs[a.size()][b.size()];
+}
+
+/**
+ *  @brief Checks diff_tokens on random fingerprint streams against a
+ *  brute force edit distance, and on Tokens.
+ *  @param silent toggles printing to std::cout on/off.
+ *  @returns true if every check passed.
+**/
+bool run_token_diff_tests(bool silent) {
+    bool passed = true;
+
+    // NOTE: small alphabets give many equal Tokens, so many equally short
+    // scripts to pick from
+    std::mt19937 random(26);
+    bool valid = true;
+    bool minimal = true;
+    for (int i=0; i < 2000; i++) {
+        std::vector<uint64_t> a(random() % 30), b(random() % 30);
+        uint64_t alphabet = 1 + random() % 4;
+        for (uint64_t& x : a) {
+            x = random() % alphabet;
+        }
+        for (uint64_t& x : b) {
+            x = random() % alphabet;
+        }
+
+        size_t cost = 0;
+        std::vector<TokenEdit> edits = diff_tokens(a, b);
+        valid &= applies(a, b, edits, cost);
+        minimal &= cost == edit_distance(a, b);
+    }
+    passed &= check("random diffs apply", valid, silent);
+    passed &= check("random diffs are minimal", minimal, silent);
+
+    // NOTE: past max_cost the script only has to be correct
+    valid = true;
+    for (int i=0; i < 200; i++) {
+        std::vector<uint64_t> a(200 + random() % 100), b(200 + random() % 100);
+        for (uint64_t& x : a) {
+            x = random() % 8;
+        }
+        for (uint64_t& x : b) {
+            x = random() % 8;
+        }
+        TokenDiffOptions options;
+        options.max_cost = 1 + random() % 8;
+        size_t cost = 0;
+        valid &= applies(a, b, diff_tokens(a, b, options), cost);
+    }
+    passed &= check("diffs past max_cost apply", valid, silent);
+
+    std::vector<uint64_t> same = {1, 2, 3};
+    passed &= check("no edits for equal streams", diff_tokens(same, same).empty(), silent);
+
+    std::vector<Token> old_tokens = tokenize_source("def f(x):\n    return x + 1\n");
+    std::vector<Token> new_tokens = tokenize_source("def f(x):\n    return y + 1\n\nf(2)\n");
+    std::vector<TokenEdit> edits = diff_tokens(old_tokens, new_tokens);
+    std::vector<std::string> described;
+    for (const TokenEdit& edit : edits) {
+        std::string text;
+        for (uint32_t i=edit.old_tokens.begin; i < edit.old_tokens.end; i++) {
+            text += "-" + std::string(old_tokens[i].text()) + " ";
+        }
+        for (uint32_t i=edit.new_tokens.begin; i < edit.new_tokens.end; i++) {
+            text += "+" + (new_tokens[i].kind == TokenKind::NEWLINE || new_tokens[i].kind == TokenKind::NL ? new_tokens[i].type : std::string(new_tokens[i].text())) + " ";
+        }
+        described.push_back(text);
+    }
+    // NOTE: the blank line's NL comes before the DEDENT, the call after it
+    passed &= compare_results("Token edits", {
+        "-x +y ",
+        "+NL ",
+        "+f +( +2 +) +NEWLINE ",
+    }, described, silent);
+
+    return passed;
+}
@@ -0,0 +1,152 @@
+#include <string>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdint>
+#include <unistd.h>
+#include "util.h"
+#include "token.h"
+#include "token-sink.h"
+#include "token-index.h"
+#include "regex-tokenizer.h"
+#include "unit-testing-util.h"
+#include "unit-tests.h"
+
+/**
+ *  @brief Every match of query in files, found by checking every position.
+**/
+static std::vector<TokenIndexMatch> find_all(const std::vector<FingerprintSink>& files, const std::vector<QueryToken>& query) {
+    std::vector<TokenIndexMatch> matches;
+    for (uint32_t file=0; file < files.size(); file++) {
+        const FingerprintSink& tokens = files[file];
+        for (size_t token=0; !query.empty() && token + query.size() <= tokens.fingerprints.size(); token++) {
+            bool match = true;
+            for (size_t i=0; i < query.size() && match; i++) {
+                match =
+                    tokens.kinds[token+i] == (uint8_t)query[i].kind &&
+                    (query[i].any_value || tokens.fingerprints[token+i] == query[i].fingerprint);
+            }
+            if (match) {
+                matches.push_back({file, (uint32_t)token, tokens.lines[token]});
+            }
+        }
+    }
+    return matches;
+}
+
+/**
+ *  @returns matches as "file:line: token N" lines, like regex-tokenizer-main --query.
+**/
+static std::vector<std::string> match_lines(const std::vector<TokenIndexMatch>& matches) {
+    std::vector<std::string> lines;
+    for (const TokenIndexMatch& match : matches) {
+        lines.push_back(std::to_string(match.file) + ":" + std::to_string(match.line) + ": token " + std::to_string(match.token));
+    }
+    return lines;
+}
+
+/**
+ *  @returns The contents of fname.
+**/
+static std::string read_index(const std::string& fname) {
+    std::ifstream in(fname, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+/**
+ *  @brief Checks TokenIndex queries against a brute force search of the
+ *  same Tokens, that merging many sorted runs writes the same index as one,
+ *  and that a damaged index is rejected.
+ *  @param silent toggles printing to std::cout on/off.
+ *  @returns true if every check passed.
+**/
+bool run_token_index_tests(bool silent) {
+    bool passed = true;
+
+    // NOTE: generated files sharing names and shapes, so trigrams repeat
+    // within and across files
+    std::mt19937 random(44);
+    const char* names[] = {"self", "x", "np", "value", "os"};
+    TokenIndexBuilder builder;
+    TokenIndexBuilder small_runs(7);
+    std::vector<FingerprintSink> files;
+    for (int file=0; file < 40; file++) {
+        std::string source = "import os\n";
+        for (int line=0; line < 30; line++) {
+            std::string a = names[random() % 5];
+            std::string b = names[random() % 5];
+            switch (random() % 4) {
+                case 0: source += a + "." + b + " = " + std::to_string(random() % 3) + "\n"; break;
+                case 1: source += "print(" + a + ", '" + b + "')\n"; break;
+                case 2: source += "def f" + std::to_string(line) + "(" + a + "):\n    return " + b + "\n"; break;
+                default: source += a + " = " + b + "(" + a + ")\n"; break;
+            }
+        }
+        BasicTokenizer<FingerprintSink> tokenizer(split_lines(source));
+        files.push_back(tokenizer.get_sink());
+        builder.add_file("file" + std::to_string(file) + ".py", files.back());
+        small_runs.add_file("file" + std::to_string(file) + ".py", files.back());
+    }
+
+    char fname[] = "/tmp/regex-tokenizer-index-XXXXXX";
+    int fd = mkstemp(fname);
+    if (fd == -1) {
+        throw std::runtime_error("mkstemp() failed");
+    }
+    close(fd);
+    small_runs.write(fname);
+    std::string merged = read_index(fname);
+    builder.write(fname);
+    passed &= check("runs of 7 postings", !merged.empty() && merged == read_index(fname), silent);
+
+    {
+        TokenIndex index(fname);
+        passed &= check("file table", index.file_count() == files.size() && index.file_name(7) == "file7.py" && index.trigram_count() > 0, silent);
+
+        const char* queries[] = {
+            "self . NAME =",
+            "NAME ( NAME )",
+            "def NAME ( self",
+            "return NAME",
+            "print ( NAME , STRING )",
+            "import os",
+            ".",
+            "NUMBER",
+            "np = np ( np )",
+            "( ) )",
+            "lambda NAME : NAME",
+        };
+        for (const char* query_text : queries) {
+            std::vector<QueryToken> query = parse_token_query(query_text);
+            passed &= compare_results(std::string("query '") + query_text + "'", match_lines(find_all(files, query)), match_lines(index.find(query)), silent);
+        }
+
+        std::vector<QueryToken> query = parse_token_query("NAME . NAME");
+        std::vector<TokenIndexMatch> all = index.find(query);
+        std::vector<TokenIndexMatch> first = index.find(query, 5);
+        passed &= check("max_matches", all.size() > 5 && match_lines(first) == match_lines({all.begin(), all.begin() + 5}), silent);
+    }
+
+    // NOTE: cut off at a few sizes, including inside the header and the tables
+    std::string contents = read_index(fname);
+    bool rejected = true;
+    for (size_t size : {(size_t)0, (size_t)7, (size_t)64, contents.size() / 2, contents.size() - 1}) {
+        {
+            std::ofstream out(fname, std::ios::binary | std::ios::trunc);
+            out.write(contents.data(), size);
+        }
+        try {
+            TokenIndex index(fname);
+            (void)index.find(parse_token_query("self . NAME ="));
+            rejected = false;
+        }
+        catch (const std::runtime_error&) {
+        }
+    }
+    passed &= check("truncated index", rejected, silent);
+    std::remove(fname);
+
+    return passed;
+}
@@ -0,0 +1,106 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+#include "util.h"
+#include "token.h"
+#include "token-pipeline.h"
+#include "regex-tokenizer.h"
+#include "unit-testing-util.h"
+#include "unit-tests.h"
+
+/**
+ *  @brief Consumes a whole TokenPipeline.
+ *  @param delay waited before taking every batch, a slow consumer.
+ *  @returns Every Token, in order.
+**/
+static std::vector<Token> consume(TokenPipeline& pipeline, std::chrono::microseconds delay) {
+    std::vector<Token> tokens, batch;
+    while (true) {
+        std::this_thread::sleep_for(delay);
+        if (!pipeline.next_batch(batch)) {
+            return tokens;
+        }
+        tokens.insert(tokens.end(), batch.begin(), batch.end());
+    }
+}
+
+/**
+ *  @brief Checks that a TokenPipeline gives the same Tokens as a Tokenizer
+ *  for any batch and queue size, that a full queue holds the producer back,
+ *  and that a tokenizer error comes out of next_batch.
+ *  @param silent toggles printing to std::cout on/off.
+ *  @returns true if every check passed.
+**/
+bool run_token_pipeline_tests(bool silent) {
+    bool passed = true;
+
+    std::string source;
+    for (int i=0; i < 100; i++) {
+        source += "def f" + std::to_string(i) + "(x):\n    return [x, (x + 1), '''a\nb''']\n";
+    }
+    std::vector<std::string> expected = token_lines(tokenize_source(source));
+
+    for (size_t batch_size : {1, 7, 256, 100000}) {
+        for (size_t queue_batches : {1, 2, 64}) {
+            std::string name = "batches of " + std::to_string(batch_size) + ", queue of " + std::to_string(queue_batches);
+            TokenPipeline pipeline(split_lines(source), batch_size, queue_batches);
+            std::vector<Token> tokens = consume(pipeline, std::chrono::microseconds(0));
+            passed &= compare_results(name, expected, token_lines(tokens), silent);
+        }
+    }
+
+    {
+        // NOTE: with a queue of 1 the producer can only be 2 batches ahead, every
+        // function has its own name so the Interner shows how far it got
+        Interner interner;
+        TokenizerOptions options;
+        options.interner = &interner;
+        TokenPipeline pipeline(split_lines(source), 16, 1, options);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        passed &= check("producer waits for the consumer", interner.size() < 20, silent);
+
+        std::vector<Token> tokens = consume(pipeline, std::chrono::microseconds(200));
+        passed &= compare_results("slow consumer", expected, token_lines(tokens), silent);
+        passed &= check("slow consumer interned every name", interner.size() == 103, silent);
+    }
+
+    {
+        // NOTE: the producer is stuck on a full queue, dropping the pipeline
+        // has to stop it instead of waiting for a consumer forever
+        TokenPipeline* pipeline = new TokenPipeline(split_lines(source), 1, 2);
+        std::vector<Token> batch;
+        bool first = pipeline->next_batch(batch);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        delete pipeline;
+        passed &= check("dropped while the queue is full", first && batch.size() == 1, silent);
+    }
+
+    {
+        // NOTE: the dedent to column 2 matches no indentation level
+        std::string bad = "x = 1\nif x:\n    y = [1,\n 2]\n  z = 3\n";
+        TokenPipeline pipeline(split_lines(bad), 2, 1);
+        std::vector<Token> tokens, batch;
+        std::string error;
+        try {
+            while (pipeline.next_batch(batch)) {
+                tokens.insert(tokens.end(), batch.begin(), batch.end());
+            }
+        }
+        catch (const std::runtime_error& e) {
+            error = e.what();
+        }
+        passed &= check("error rethrown", error.find("unindent does not match") != std::string::npos, silent);
+        passed &= check("Tokens before the error", tokens.size() > 10 && tokens.back().kind != TokenKind::ENDMARKER, silent);
+
+        bool ended = false;
+        try {
+            ended = !pipeline.next_batch(batch);
+        }
+        catch (const std::exception&) {}
+        passed &= check("error rethrown once", ended, silent);
+    }
+
+    return passed;
+}
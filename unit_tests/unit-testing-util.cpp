@@ -4,6 +4,12 @@
 #include <memory>
 #include <vector>
 #include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+#include <unistd.h>
+#include "unit-testing-util.h"
 
 // https://stackoverflow.com/questions/478898/how-do-i-execute-a-command-and-get-the-output-of-the-command-within-c-using-po
 std::string exec_command(const char* cmd) {
@@ -36,36 +42,27 @@ std::vector<std::string> split_on_newline(char* str) {
 	return lines;
 }
 
+/**
+ *  @brief Prints the lines around line i of both results, i.e. where they differ.
+**/
 void print_mismatch(
-	const std::vector<std::string>& python_tokenizer_results,
-	const std::vector<std::string>& regex_tokenizer_results,
+	const std::string& expected_name,
+	const std::vector<std::string>& expected,
+	const std::string& actual_name,
+	const std::vector<std::string>& actual,
 	int i
 ) {
-    std::cout << "regex-tokenizer-main" << std::endl;
-	if (i > 0) {
-		std::cout
-			<< regex_tokenizer_results.at(i-1) << std::endl
-			<< regex_tokenizer_results.at(i) << std::endl
-			<< regex_tokenizer_results.at(i+1) << std::endl;
-	}
-	else {
-		std::cout
-			<< regex_tokenizer_results.at(i) << std::endl
-			<< regex_tokenizer_results.at(i+1) << std::endl;
-	}
-
-	std::cout << "python -m tokenize" << std::endl;
-	if (i > 0) {
-		std::cout
-			<< python_tokenizer_results.at(i-1) << std::endl
-			<< python_tokenizer_results.at(i) << std::endl
-			<< python_tokenizer_results.at(i+1) << std::endl;
-	}
-	else {
-		std::cout
-			<< python_tokenizer_results.at(i) << std::endl
-			<< python_tokenizer_results.at(i+1) << std::endl;
-	}
+	auto print_around = [&](const std::string& name, const std::vector<std::string>& lines) {
+		std::cout << name << std::endl;
+		for (int j=std::max(0, i-1); j <= i+1 && j < (int)lines.size(); j++) {
+			std::cout << lines.at(j) << std::endl;
+		}
+		if (i >= (int)lines.size()) {
+			std::cout << "(no line " << i+1 << ")" << std::endl;
+		}
+	};
+	print_around(actual_name, actual);
+	print_around(expected_name, expected);
 }
 
 /**
@@ -74,7 +71,7 @@ void print_mismatch(
  *  @param silent toggles printing to std::cout on/off.
  *  @returns true if tokenization results match, else false.
 **/
-bool compare_tokenization_results(const std::string& fname, bool silent=false) {
+bool compare_tokenization_results(const std::string& fname, bool silent) {
 	std::string result1 = exec_command(
         ("python3 -m tokenize " + fname).c_str()
     );
@@ -84,12 +81,19 @@ bool compare_tokenization_results(const std::string& fname, bool silent=false) {
     );
     std::vector<std::string> regex_tokenizer_results = split_on_newline(&result2[0]);
 
-	for (int i=0; i < (int)python_tokenizer_results.size(); i++) {
-		if (python_tokenizer_results.at(i) != regex_tokenizer_results.at(i)) {
+	// NOTE: the size check also catches one output stopping early
+	for (int i=0; i < (int)std::max(python_tokenizer_results.size(), regex_tokenizer_results.size()); i++) {
+		if (
+			i >= (int)python_tokenizer_results.size() ||
+			i >= (int)regex_tokenizer_results.size() ||
+			python_tokenizer_results.at(i) != regex_tokenizer_results.at(i)
+		) {
             if (!silent) {
                 std::cout << std::endl;
                 print_mismatch(
+                    "python -m tokenize",
                     python_tokenizer_results,
+                    "regex-tokenizer-main",
                     regex_tokenizer_results,
                     i
                 );
@@ -109,3 +113,83 @@ bool compare_tokenization_results(const std::string& fname, bool silent=false) {
     }
     return true;
 }
+
+/**
+ *  @brief Writes contents to a new file in /tmp, remove it once done.
+ *  @returns The name of the file.
+**/
+std::string write_temporary_file(const std::string& contents) {
+	char fname[] = "/tmp/regex-tokenizer-test-XXXXXX";
+	int fd = mkstemp(fname);
+	if (fd == -1) {
+		throw std::runtime_error("mkstemp() failed");
+	}
+	close(fd);
+
+	std::ofstream file(fname, std::ios::binary);
+	file << contents;
+	return fname;
+}
+
+/**
+ *  @brief compare_tokenization_results for source instead of a file, writes it
+ *  to a temporary file first.
+ *  @param name what is being compared, printed with the result.
+ *  @param source python source to tokenize.
+ *  @param silent toggles printing to std::cout on/off.
+ *  @returns true if tokenization results match, else false.
+**/
+bool compare_source_tokenization_results(const std::string& name, const std::string& source, bool silent) {
+	std::string fname = write_temporary_file(source);
+
+	if (!silent) {
+		std::cout << name << ":";
+	}
+	bool matched = compare_tokenization_results(fname, silent);
+	std::remove(fname.c_str());
+	return matched;
+}
+
+/**
+ *  @brief Compares two results line by line, like compare_tokenization_results.
+ *  @param name what is being compared, printed with the result.
+ *  @param expected lines that should come out.
+ *  @param actual lines that came out.
+ *  @param silent toggles printing to std::cout on/off.
+ *  @returns true if the results match, else false.
+**/
+bool compare_results(
+	const std::string& name,
+	const std::vector<std::string>& expected,
+	const std::vector<std::string>& actual,
+	bool silent
+) {
+	for (int i=0; i < (int)std::max(expected.size(), actual.size()); i++) {
+		if (i >= (int)expected.size() || i >= (int)actual.size() || expected.at(i) != actual.at(i)) {
+			if (!silent) {
+				std::cout << std::endl;
+				print_mismatch("expected", expected, "actual", actual, i);
+				std::cout << name << " DID NOT match" << std::endl;
+			}
+			return false;
+		}
+	}
+	if (!silent) {
+		std::cout << name << " matches" << std::endl;
+	}
+	return true;
+}
+
+/**
+ *  @brief Reports a single check.
+ *  @param name what is being checked, printed with the result.
+ *  @param passed result of the check.
+ *  @param silent toggles printing to std::cout on/off.
+ *  @returns passed.
+**/
+bool check(const std::string& name, bool passed, bool silent) {
+	if (!silent) {
+		std::cout << name << (passed ? " passed" : " DID NOT pass") << std::endl;
+	}
+	return passed;
+}
@@ -2,7 +2,20 @@
 #define UNIT_TESTING_UTIL_H
 
 #include <string>
+#include <vector>
 
-void compare_tokenization_results(const std::string& fname, bool silent);
+std::string exec_command(const char* cmd);
+std::vector<std::string> split_on_newline(char* str);
+std::string write_temporary_file(const std::string& contents);
+
+bool compare_tokenization_results(const std::string& fname, bool silent=false);
+bool compare_source_tokenization_results(const std::string& name, const std::string& source, bool silent=false);
+bool compare_results(
+    const std::string& name,
+    const std::vector<std::string>& expected,
+    const std::vector<std::string>& actual,
+    bool silent=false
+);
+bool check(const std::string& name, bool passed, bool silent=false);
 
 #endif
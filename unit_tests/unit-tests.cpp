@@ -0,0 +1,74 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "util.h"
+#include "token.h"
+#include "regex-tokenizer.h"
+#include "unit-tests.h"
+
+/**
+ *  @brief Tokenizes source like regex-tokenizer-main tokenizes a file.
+ *  @returns Every Token of source.
+**/
+std::vector<Token> tokenize_source(const std::string& source, const TokenizerOptions& options) {
+    Tokenizer tokenizer(split_lines(source), options);
+    return std::move(tokenizer.get_sink().tokens);
+}
+
+/**
+ *  @returns tokens as regex-tokenizer-main prints them, one per line.
+**/
+std::vector<std::string> token_lines(const std::vector<Token>& tokens) {
+    std::vector<std::string> lines;
+    for (const Token& token : tokens) {
+        std::ostringstream line;
+        line << token;
+        lines.push_back(line.str());
+    }
+    return lines;
+}
+
+// NOTE: unit-tests [-s], -s only prints the summary. Run from the repository
+// root after make, the python comparisons call ./regex-tokenizer-main
+int main(int argc, char* argv[]) {
+    bool silent = argc > 1 && std::string(argv[1]) == "-s";
+
+    struct Group {
+        const char* name;
+        bool (*run)(bool silent);
+    };
+    const Group groups[] = {
+        {"identifiers", run_identifier_tests},
+        {"strings", run_string_tests},
+        {"numbers", run_number_tests},
+        {"interner", run_interner_tests},
+        {"line cache", run_line_cache_tests},
+        {"structure index", run_structure_index_tests},
+        {"C ABI", run_c_abi_tests},
+        {"deadlines", run_deadline_tests},
+        {"token diff", run_token_diff_tests},
+        {"token index", run_token_index_tests},
+        {"format", run_format_tests},
+        {"batch", run_batch_tests},
+        {"token pipeline", run_token_pipeline_tests},
+        {"sinks", run_sink_tests},
+        {"keywords", run_keyword_tests},
+    };
+
+    int failed = 0;
+    for (const Group& group : groups) {
+        if (!silent) {
+            std::cout << "== " << group.name << std::endl;
+        }
+        bool passed = group.run(silent);
+        failed += !passed;
+        if (!silent) {
+            std::cout << std::endl;
+        }
+        std::cout << group.name << (passed ? ": passed" : ": FAILED") << std::endl;
+    }
+
+    std::cout << (sizeof(groups) / sizeof(groups[0]) - failed) << " of " << sizeof(groups) / sizeof(groups[0]) << " groups passed" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
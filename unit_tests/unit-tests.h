@@ -0,0 +1,30 @@
+#ifndef UNIT_TESTS_H
+#define UNIT_TESTS_H
+
+#include <string>
+#include <vector>
+#include "token.h"
+#include "regex-tokenizer.h"
+
+// NOTE: every group runs its checks and returns true if all of them passed,
+// see unit-tests.cpp. The python comparisons need ./regex-tokenizer-main
+bool run_identifier_tests(bool silent);
+bool run_string_tests(bool silent);
+bool run_number_tests(bool silent);
+bool run_interner_tests(bool silent);
+bool run_line_cache_tests(bool silent);
+bool run_structure_index_tests(bool silent);
+bool run_c_abi_tests(bool silent);
+bool run_deadline_tests(bool silent);
+bool run_token_diff_tests(bool silent);
+bool run_token_index_tests(bool silent);
+bool run_format_tests(bool silent);
+bool run_batch_tests(bool silent);
+bool run_token_pipeline_tests(bool silent);
+bool run_sink_tests(bool silent);
+bool run_keyword_tests(bool silent);
+
+std::vector<Token> tokenize_source(const std::string& source, const TokenizerOptions& options = TokenizerOptions());
+std::vector<std::string> token_lines(const std::vector<Token>& tokens);
+
+#endif